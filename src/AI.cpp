@@ -0,0 +1,176 @@
+// SPDX-FileCopyrightText: 2022 metaquarx <metaquarx@protonmail.com>
+// SPDX-License-Identifier: GPL-3.0-only
+
+#include "AI.hpp"
+
+#include <algorithm>
+#include <limits>
+
+namespace {
+
+// Nodes searched between looks at the clock
+constexpr unsigned deadline_interval = 256;
+// Deeper than any budget will reach, but stops a nearly full board from deepening forever
+constexpr unsigned max_iterative_depth = 32;
+
+// The heuristic of AIs that aren't given one
+template <std::size_t N>
+const BasicHeuristic<N> & default_heuristic() {
+	static const BasicHeuristic<N> heuristic;
+	return heuristic;
+}
+
+}
+
+template <std::size_t N>
+BasicAI<N>::BasicAI(unsigned depth, TranspositionTable * table, const BasicHeuristic<N> * heuristic)
+: m_depth(std::max(depth, 1u))
+, m_table(table)
+, m_heuristic(heuristic ? heuristic : &default_heuristic<N>()) {
+}
+
+template <typename Values>
+static std::optional<Move> best_of(const Values & values) {
+	std::optional<Move> best;
+	for (std::size_t i = 0; i < values.size(); i++) {
+		if (values[i] && (!best || *values[i] > *values[static_cast<std::size_t>(*best)])) {
+			best = all_moves[i];
+		}
+	}
+	return best;
+}
+
+template <std::size_t N>
+std::optional<Move> BasicAI<N>::choose(Board board) const {
+	return best_of(search_root(board, m_depth, all_moves, nullptr));
+}
+
+template <std::size_t N>
+std::optional<Move> BasicAI<N>::choose(Board board, std::chrono::steady_clock::duration budget) const {
+	Deadline deadline{std::chrono::steady_clock::now() + budget, deadline_interval, false};
+
+	// the first pass runs to the end whatever the budget, so there is always an answer
+	auto values = search_root(board, 1, all_moves, nullptr);
+	auto order = all_moves;
+
+	for (unsigned depth = 2; depth <= max_iterative_depth && !deadline.check(); depth++) {
+		// the best moves so far go first, so they get the deepest look if time runs out
+		std::stable_sort(order.begin(), order.end(), [&](Move a, Move b) {
+			auto & value_a = values[static_cast<std::size_t>(a)];
+			auto & value_b = values[static_cast<std::size_t>(b)];
+			constexpr auto none = std::numeric_limits<float>::lowest();
+			return value_a.value_or(none) > value_b.value_or(none);
+		});
+
+		auto deeper = search_root(board, depth, order, &deadline);
+		if (!deadline.expired) {
+			values = deeper;
+			continue;
+		}
+
+		// a pass cut short still counts once it has finished the best move so far,
+		// which it searches first. Its values are only compared with each other:
+		// one more spawn costs score, so deeper values sit below shallower ones
+		if (deeper[static_cast<std::size_t>(order[0])]) {
+			values = deeper;
+		}
+		break;
+	}
+
+	return best_of(values);
+}
+
+template <std::size_t N>
+bool BasicAI<N>::Deadline::check() {
+	if (!expired && --countdown == 0) {
+		countdown = deadline_interval;
+		expired = std::chrono::steady_clock::now() >= end;
+	}
+	return expired;
+}
+
+template <std::size_t N>
+typename BasicAI<N>::RootValues BasicAI<N>::search_root(Board board, unsigned depth, const std::array<Move, 4> & order, Deadline * deadline) const {
+	RootValues values;
+	for (auto move : order) {
+		auto result = board.moved(move);
+		if (result.board == board) {
+			continue;
+		}
+
+		auto value = static_cast<float>(result.score) + chance_node(result.board, depth - 1, deadline);
+		// the move the deadline cut off is left without a value
+		if (deadline && deadline->expired) {
+			break;
+		}
+		values[static_cast<std::size_t>(move)] = value;
+	}
+	return values;
+}
+
+template <std::size_t N>
+float BasicAI<N>::max_node(Board board, unsigned depth, Deadline * deadline) const {
+	// the value no longer matters once the search is cut off, as long as it isn't cached
+	if (deadline && deadline->check()) {
+		return 0.f;
+	}
+
+	// a lost board is worth less than any board still in play
+	float best_value = m_heuristic->lost_score();
+	for (auto move : all_moves) {
+		auto result = board.moved(move);
+		if (result.board != board) {
+			best_value = std::max(best_value, static_cast<float>(result.score) + chance_node(result.board, depth - 1, deadline));
+		}
+	}
+	return best_value;
+}
+
+template <std::size_t N>
+float BasicAI<N>::chance_node(Board board, unsigned depth, Deadline * deadline) const {
+	if (depth == 0) {
+		return m_heuristic->evaluate(board);
+	}
+
+	if (deadline && deadline->expired) {
+		return 0.f;
+	}
+
+	if (m_table) {
+		if (auto cached = m_table->probe(board.canonical_key(), depth)) {
+			return *cached;
+		}
+	}
+
+	// spawns are a 2 or a 4 with equal odds, on any empty cell
+	float total = 0.f;
+	unsigned count = 0;
+	for (std::size_t x = 0; x < N; x++) {
+		for (std::size_t y = 0; y < N; y++) {
+			if (board.get(x, y)) {
+				continue;
+			}
+
+			for (unsigned value = 1; value <= 2; value++) {
+				auto next = board;
+				next.set(x, y, value);
+				total += max_node(next, depth, deadline);
+				count++;
+			}
+		}
+	}
+
+	float value = count ? total / static_cast<float>(count) : m_heuristic->evaluate(board);
+	if (m_table && !(deadline && deadline->expired)) {
+		m_table->store(board.canonical_key(), depth, value);
+	}
+	return value;
+}
+
+
+template class BasicAI<3>;
+template class BasicAI<4>;
+template class BasicAI<5>;
+template class BasicAI<6>;
+template class BasicAI<7>;
+template class BasicAI<8>;
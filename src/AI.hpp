@@ -0,0 +1,72 @@
+// SPDX-FileCopyrightText: 2022 metaquarx <metaquarx@protonmail.com>
+// SPDX-License-Identifier: GPL-3.0-only
+
+#pragma once
+
+#include "Board.hpp"
+#include "Heuristic.hpp"
+#include "TranspositionTable.hpp"
+
+#include <array>
+#include <chrono>
+#include <optional>
+
+// Small expectimax player. Works on packed boards only, so it never touches
+// Tile and can be called thousands of times a second.
+// Given a transposition table, chance nodes are cached there under their
+// canonical board, so all eight symmetric versions of a position share one
+// entry. The table can be shared by any number of AIs searching on other
+// threads, as long as they score boards with the same heuristic. Ageing the
+// table with new_search() is left to whoever owns it, once per game or batch
+// rather than once per move, so results from the last few moves stay put.
+//
+// choose() searches to a fixed depth, which takes anywhere from microseconds
+// to seconds depending on how many cells are empty. Given a time budget
+// instead, it searches one level deeper at a time until the budget runs out,
+// and answers from the deepest search it finished, or from the moves the last,
+// cut short search got through if the best move so far was among them.
+template <std::size_t N>
+class BasicAI {
+public:
+	using Board = BasicBoard<N>;
+
+	// Without a heuristic, boards are scored with the default weights
+	explicit BasicAI(unsigned depth = 2, TranspositionTable * table = nullptr, const BasicHeuristic<N> * heuristic = nullptr);
+
+	std::optional<Move> choose(Board board) const;
+	// Always finishes at least a depth 1 search, and then stops within a few
+	// microseconds of the budget
+	std::optional<Move> choose(Board board, std::chrono::steady_clock::duration budget) const;
+
+private:
+	unsigned m_depth;
+	TranspositionTable * m_table;
+	const BasicHeuristic<N> * m_heuristic;
+
+	// Cut off searches once the clock runs out. Looking at the clock costs
+	// more than a node, so it is only read every so often.
+	struct Deadline {
+		std::chrono::steady_clock::time_point end;
+		unsigned countdown;
+		bool expired;
+
+		bool check();
+	};
+
+	// Value of every move at the root, nullopt for the ones that don't move or
+	// that a deadline stopped from being searched to the end
+	using RootValues = std::array<std::optional<float>, all_moves.size()>;
+	RootValues search_root(Board board, unsigned depth, const std::array<Move, 4> & order, Deadline * deadline) const;
+
+	float max_node(Board board, unsigned depth, Deadline * deadline) const;
+	float chance_node(Board board, unsigned depth, Deadline * deadline) const;
+};
+
+using AI = BasicAI<4>;
+
+extern template class BasicAI<3>;
+extern template class BasicAI<4>;
+extern template class BasicAI<5>;
+extern template class BasicAI<6>;
+extern template class BasicAI<7>;
+extern template class BasicAI<8>;
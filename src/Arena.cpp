@@ -0,0 +1,181 @@
+// SPDX-FileCopyrightText: 2022 metaquarx <metaquarx@protonmail.com>
+// SPDX-License-Identifier: GPL-3.0-only
+
+#include "Arena.hpp"
+
+#include "Tile.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <string>
+#include <thread>
+
+namespace {
+
+// Numbers any smaller than this aren't worth drawing
+constexpr unsigned min_character_size = 8;
+// Boards per piece of work when picking moves
+constexpr std::size_t boards_per_range = 16;
+
+void add_quad(sf::VertexArray & vertices, sf::FloatRect rect, sf::Color colour, sf::FloatRect texture = {}) {
+	sf::Vector2f corners[4] = {
+		{rect.left, rect.top},
+		{rect.left + rect.width, rect.top},
+		{rect.left + rect.width, rect.top + rect.height},
+		{rect.left, rect.top + rect.height},
+	};
+	sf::Vector2f texture_corners[4] = {
+		{texture.left, texture.top},
+		{texture.left + texture.width, texture.top},
+		{texture.left + texture.width, texture.top + texture.height},
+		{texture.left, texture.top + texture.height},
+	};
+
+	for (auto i : {0, 1, 2, 0, 2, 3}) {
+		vertices.append(sf::Vertex(corners[i], colour, texture_corners[i]));
+	}
+}
+
+}
+
+void ArenaSnapshot::draw(sf::RenderTarget & target, sf::RenderStates states) const {
+	target.draw(shapes, states);
+
+	if (glyph_texture && glyphs.getVertexCount()) {
+		states.texture = glyph_texture;
+		target.draw(glyphs, states);
+	}
+}
+
+Arena::Arena(std::size_t count, const sf::Font & font, sf::Vector2f area)
+: m_games(count, std::random_device{}(), 1)
+, m_actions(count)
+, m_observations(count * GameBatch::observation_size)
+, m_rewards(count)
+, m_dones(count)
+, m_pool(std::max(std::thread::hardware_concurrency(), 1u))
+, m_ai(1)
+, m_font(font)
+, m_columns(1)
+, m_board_size(0.f) {
+	// as many columns as gives the biggest boards
+	for (std::size_t columns = 1; columns <= std::max<std::size_t>(count, 1); columns++) {
+		auto rows = (count + columns - 1) / columns;
+		auto size = std::min(area.x / static_cast<float>(columns), area.y / static_cast<float>(rows));
+		if (size > m_board_size) {
+			m_board_size = size;
+			m_columns = columns;
+		}
+	}
+
+	// same proportions as the 4x4 Grid, 14px gaps on a 586px board
+	m_gap = std::max(1.f, std::floor(m_board_size * 14.f / 600.f));
+	// four tiles and five gaps across the background, which is inset by a gap
+	m_tile_size = (m_board_size - 7.f * m_gap) / 4.f;
+
+	m_character_size = static_cast<unsigned>(m_tile_size * .45f);
+	if (m_character_size >= min_character_size) {
+		for (std::size_t i = 0; i < m_digits.size(); i++) {
+			m_digits[i] = m_font.getGlyph(static_cast<sf::Uint32>('0' + i), m_character_size, false);
+		}
+	}
+
+	restart();
+}
+
+void Arena::update(float dt, unsigned rate) {
+	m_steps.update(dt, 1.f / static_cast<float>(std::max(rate, 1u)), [this] {
+		step();
+		return true;
+	});
+}
+
+void Arena::restart() {
+	m_games.reset(m_observations.data());
+	m_steps.reset();
+}
+
+void Arena::snapshot(ArenaSnapshot & snapshot) const {
+	snapshot.shapes.clear();
+	snapshot.glyphs.clear();
+	bool numbers = m_character_size >= min_character_size;
+	snapshot.glyph_texture = numbers ? &m_font.getTexture(m_character_size) : nullptr;
+
+	auto boards = m_games.get_boards();
+	for (std::size_t i = 0; i < size(); i++) {
+		sf::Vector2f origin{
+			static_cast<float>(i % m_columns) * m_board_size + m_gap,
+			static_cast<float>(i / m_columns) * m_board_size + m_gap
+		};
+		float inner = m_board_size - 2.f * m_gap;
+		add_quad(snapshot.shapes, {origin.x, origin.y, inner, inner}, sf::Color(187, 173, 160));
+
+		for (std::size_t cell = 0; cell < 16; cell++) {
+			auto value = static_cast<unsigned>((boards[i] >> (4 * cell)) & 0xF);
+			sf::FloatRect rect{
+				origin.x + m_gap + static_cast<float>(cell % 4) * (m_tile_size + m_gap),
+				origin.y + m_gap + static_cast<float>(cell / 4) * (m_tile_size + m_gap),
+				m_tile_size,
+				m_tile_size
+			};
+
+			if (!value) {
+				add_quad(snapshot.shapes, rect, sf::Color(205, 193, 180));
+				continue;
+			}
+
+			auto colours = colour_of(value);
+			add_quad(snapshot.shapes, rect, colours.first);
+
+			if (!numbers) {
+				continue;
+			}
+
+			// digits are laid out by hand from the cached glyphs, shrunk to fit the tile
+			auto text = std::to_string(1u << value);
+			float width = 0.f;
+			for (auto digit : text) {
+				width += m_digits[static_cast<std::size_t>(digit - '0')].advance;
+			}
+			float scale = std::min(1.f, m_tile_size * .85f / width);
+			float x = rect.left + (m_tile_size - width * scale) / 2.f;
+			float baseline = rect.top + m_tile_size / 2.f + static_cast<float>(m_character_size) * .35f * scale;
+
+			for (auto digit : text) {
+				const auto & glyph = m_digits[static_cast<std::size_t>(digit - '0')];
+				sf::FloatRect quad{
+					x + glyph.bounds.left * scale,
+					baseline + glyph.bounds.top * scale,
+					glyph.bounds.width * scale,
+					glyph.bounds.height * scale
+				};
+				sf::FloatRect texture{
+					static_cast<float>(glyph.textureRect.left),
+					static_cast<float>(glyph.textureRect.top),
+					static_cast<float>(glyph.textureRect.width),
+					static_cast<float>(glyph.textureRect.height)
+				};
+				add_quad(snapshot.glyphs, quad, colours.second, texture);
+				x += glyph.advance * scale;
+			}
+		}
+	}
+}
+
+std::size_t Arena::size() const {
+	return m_games.size();
+}
+
+void Arena::step() {
+	auto boards = m_games.get_boards();
+	auto ranges = (size() + boards_per_range - 1) / boards_per_range;
+	m_pool.run(ranges, [&](std::size_t range) {
+		for (std::size_t i = range * boards_per_range; i < std::min(size(), (range + 1) * boards_per_range); i++) {
+			auto move = m_ai.choose(Board(boards[i]));
+			m_actions[i] = static_cast<std::uint8_t>(move ? *move : Move::Up);
+		}
+	});
+
+	m_games.step(m_actions.data(), m_observations.data(), m_rewards.data(), m_dones.data());
+}
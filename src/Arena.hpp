@@ -0,0 +1,64 @@
+// SPDX-FileCopyrightText: 2022 metaquarx <metaquarx@protonmail.com>
+// SPDX-License-Identifier: GPL-3.0-only
+
+#pragma once
+
+#include <SFML/Graphics.hpp>
+
+#include "AI.hpp"
+#include "FixedStep.hpp"
+#include "GameBatch.hpp"
+#include "WorkerPool.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Everything the arena draws in two vertex arrays: one draw call for every
+// board and tile, and one for every number, however many boards there are
+struct ArenaSnapshot : public sf::Drawable {
+	sf::VertexArray shapes{sf::Triangles};
+	sf::VertexArray glyphs{sf::Triangles};
+	const sf::Texture * glyph_texture = nullptr;
+
+	virtual void draw(sf::RenderTarget & target, sf::RenderStates states) const override;
+};
+
+// Many AI games played side by side, each drawn small, for watching bots
+// play. Tiles are plain squares rather than Tiles, with no animations, and
+// lose their numbers once they get too small to read.
+class Arena {
+public:
+	Arena(std::size_t count, const sf::Font & font, sf::Vector2f area);
+
+	// Plays rate moves per second in every game, or as many as FixedStep
+	// allows per update when the boards are too slow for that
+	void update(float dt, unsigned rate);
+	void restart();
+	void snapshot(ArenaSnapshot & snapshot) const;
+
+	std::size_t size() const;
+
+private:
+	GameBatch m_games;
+	std::vector<std::uint8_t> m_actions;
+	std::vector<std::uint8_t> m_observations;
+	std::vector<float> m_rewards;
+	std::vector<std::uint8_t> m_dones;
+
+	WorkerPool m_pool;
+	// depth 1 scores boards straight after a spawn, without a table
+	AI m_ai;
+	FixedStep m_steps;
+
+	const sf::Font & m_font;
+	std::size_t m_columns;
+	float m_board_size;
+	float m_gap;
+	float m_tile_size;
+	unsigned m_character_size;
+	std::array<sf::Glyph, 10> m_digits;
+
+	void step();
+};
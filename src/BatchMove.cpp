@@ -0,0 +1,168 @@
+// SPDX-FileCopyrightText: 2022 metaquarx <metaquarx@protonmail.com>
+// SPDX-License-Identifier: GPL-3.0-only
+
+#include "BatchMove.hpp"
+
+#include <algorithm>
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define TFE_HAS_AVX2_KERNEL
+#include <immintrin.h>
+#endif
+
+namespace {
+
+using Kernel = void (*)(Move move, const std::uint64_t * boards, std::size_t count, BoardBatch & result);
+
+void move_scalar(Move move, const std::uint64_t * boards, std::size_t count, BoardBatch & result) {
+	for (std::size_t i = 0; i < count; i++) {
+		auto moved = Board(boards[i]).moved(move);
+		result.boards[i] = moved.board.raw();
+		result.scores[i] = moved.score;
+		if (moved.board.raw() != boards[i]) {
+			result.changed[i / 64] |= std::uint64_t{1} << (i % 64);
+		}
+	}
+}
+
+#ifdef TFE_HAS_AVX2_KERNEL
+
+// One 32 bit word per row: the moved row in the low half, the score / 4 in
+// the high half (every merge scores a multiple of 4, and at most 65536 per row)
+struct PackedTables {
+	std::vector<std::uint32_t> left;
+	std::vector<std::uint32_t> right;
+
+	PackedTables()
+	: left(1 << 16)
+	, right(1 << 16) {
+		for (std::uint32_t row = 0; row < (1 << 16); row++) {
+			auto moved_left = Board(row).moved(Move::Left);
+			auto moved_right = Board(row).moved(Move::Right);
+			left[row] = static_cast<std::uint32_t>(moved_left.board.raw()) | ((moved_left.score / 4) << 16);
+			right[row] = static_cast<std::uint32_t>(moved_right.board.raw()) | ((moved_right.score / 4) << 16);
+		}
+	}
+};
+
+const PackedTables & packed_tables() {
+	static const PackedTables tables;
+	return tables;
+}
+
+__attribute__((target("avx2")))
+__m256i transpose_avx2(__m256i x) {
+	auto a1 = _mm256_and_si256(x, _mm256_set1_epi64x(static_cast<long long>(0xF0F00F0FF0F00F0Full)));
+	auto a2 = _mm256_and_si256(x, _mm256_set1_epi64x(static_cast<long long>(0x0000F0F00000F0F0ull)));
+	auto a3 = _mm256_and_si256(x, _mm256_set1_epi64x(static_cast<long long>(0x0F0F00000F0F0000ull)));
+	auto a = _mm256_or_si256(a1, _mm256_or_si256(_mm256_slli_epi64(a2, 12), _mm256_srli_epi64(a3, 12)));
+	auto b1 = _mm256_and_si256(a, _mm256_set1_epi64x(static_cast<long long>(0xFF00FF0000FF00FFull)));
+	auto b2 = _mm256_and_si256(a, _mm256_set1_epi64x(static_cast<long long>(0x00FF00FF00000000ull)));
+	auto b3 = _mm256_and_si256(a, _mm256_set1_epi64x(static_cast<long long>(0x00000000FF00FF00ull)));
+	return _mm256_or_si256(b1, _mm256_or_si256(_mm256_srli_epi64(b2, 24), _mm256_slli_epi64(b3, 24)));
+}
+
+template <int row>
+__attribute__((target("avx2")))
+void move_row_avx2(const std::uint32_t * table, __m256i source, __m256i & cells, __m128i & score) {
+	auto index = _mm256_and_si256(_mm256_srli_epi64(source, 16 * row), _mm256_set1_epi64x(0xFFFF));
+	auto packed = _mm256_i64gather_epi32(reinterpret_cast<const int *>(table), index, 4);
+
+	auto moved = _mm256_cvtepu32_epi64(_mm_and_si128(packed, _mm_set1_epi32(0xFFFF)));
+	cells = _mm256_or_si256(cells, _mm256_slli_epi64(moved, 16 * row));
+	score = _mm_add_epi32(score, _mm_srli_epi32(packed, 16));
+}
+
+__attribute__((target("avx2")))
+void move_four_avx2(const std::uint32_t * table, bool vertical, const std::uint64_t * boards, std::size_t i, BoardBatch & result) {
+	auto source = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(boards + i));
+	auto rows = vertical ? transpose_avx2(source) : source;
+
+	auto cells = _mm256_setzero_si256();
+	auto score = _mm_setzero_si128();
+	move_row_avx2<0>(table, rows, cells, score);
+	move_row_avx2<1>(table, rows, cells, score);
+	move_row_avx2<2>(table, rows, cells, score);
+	move_row_avx2<3>(table, rows, cells, score);
+	if (vertical) {
+		cells = transpose_avx2(cells);
+	}
+
+	_mm256_storeu_si256(reinterpret_cast<__m256i *>(result.boards.data() + i), cells);
+	_mm_storeu_si128(reinterpret_cast<__m128i *>(result.scores.data() + i), _mm_slli_epi32(score, 2));
+
+	auto same = _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(cells, source)));
+	result.changed[i / 64] |= std::uint64_t{static_cast<unsigned>(~same) & 0xFu} << (i % 64);
+}
+
+// four boards per register, two registers in flight to hide the gather latency
+__attribute__((target("avx2")))
+void move_avx2(Move move, const std::uint64_t * boards, std::size_t count, BoardBatch & result) {
+	bool vertical = move == Move::Up || move == Move::Down;
+	bool positive = move == Move::Up || move == Move::Left;
+	const auto * table = positive ? packed_tables().left.data() : packed_tables().right.data();
+
+	std::size_t i = 0;
+	for (; i + 8 <= count; i += 8) {
+		move_four_avx2(table, vertical, boards, i, result);
+		move_four_avx2(table, vertical, boards, i + 4, result);
+	}
+	for (; i + 4 <= count; i += 4) {
+		move_four_avx2(table, vertical, boards, i, result);
+	}
+
+	if (i < count) {
+		BoardBatch tail;
+		tail.resize(count - i);
+		move_scalar(move, boards + i, count - i, tail);
+		for (std::size_t j = 0; j < tail.size(); j++) {
+			result.boards[i + j] = tail.boards[j];
+			result.scores[i + j] = tail.scores[j];
+			if (tail.is_changed(j)) {
+				result.changed[(i + j) / 64] |= std::uint64_t{1} << ((i + j) % 64);
+			}
+		}
+	}
+}
+
+#endif
+
+Kernel pick_kernel() {
+#ifdef TFE_HAS_AVX2_KERNEL
+	if (__builtin_cpu_supports("avx2")) {
+		return move_avx2;
+	}
+#endif
+	return move_scalar;
+}
+
+Kernel kernel() {
+	static const Kernel picked = pick_kernel();
+	return picked;
+}
+
+}
+
+void BoardBatch::resize(std::size_t count) {
+	boards.resize(count);
+	scores.resize(count);
+	changed.resize((count + 63) / 64);
+}
+
+std::size_t BoardBatch::size() const {
+	return boards.size();
+}
+
+bool BoardBatch::is_changed(std::size_t index) const {
+	return (changed[index / 64] >> (index % 64)) & 1;
+}
+
+void move_batch(Move move, const std::uint64_t * boards, std::size_t count, BoardBatch & result) {
+	result.resize(count);
+	std::fill(result.changed.begin(), result.changed.end(), 0);
+	kernel()(move, boards, count, result);
+}
+
+const char * batch_kernel_name() {
+	return kernel() == move_scalar ? "scalar" : "avx2";
+}
@@ -0,0 +1,31 @@
+// SPDX-FileCopyrightText: 2022 metaquarx <metaquarx@protonmail.com>
+// SPDX-License-Identifier: GPL-3.0-only
+
+#pragma once
+
+#include "Board.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Results for many boards side by side. Every field lives in its own array
+// so the batch kernel can load and store whole vector registers at a time.
+struct BoardBatch {
+	std::vector<std::uint64_t> boards;
+	std::vector<std::uint32_t> scores;
+	// one bit per board, set when the move changed it
+	std::vector<std::uint64_t> changed;
+
+	void resize(std::size_t count);
+	std::size_t size() const;
+	bool is_changed(std::size_t index) const;
+};
+
+// Applies the same move to count packed boards (Board::raw) at once.
+// Uses AVX2 gathers when the CPU has them, and a plain loop over
+// Board::moved otherwise; both give identical results.
+void move_batch(Move move, const std::uint64_t * boards, std::size_t count, BoardBatch & result);
+
+// Name of the kernel move_batch picked for this CPU
+const char * batch_kernel_name();
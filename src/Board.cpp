@@ -0,0 +1,424 @@
+// SPDX-FileCopyrightText: 2022 metaquarx <metaquarx@protonmail.com>
+// SPDX-License-Identifier: GPL-3.0-only
+
+#include "Board.hpp"
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+namespace {
+
+// Slides a line towards its first cell: the same shift, combine, shift as Grid::process_input
+template <std::size_t N>
+void slide_line(std::array<unsigned, N> & cells, unsigned & score, bool & reached_win) {
+	std::array<unsigned, N> tiles{};
+	std::size_t count = 0;
+	for (std::size_t i = 0; i < N; i++) {
+		if (cells[i]) {
+			tiles[count++] = cells[i];
+		}
+	}
+
+	std::array<unsigned, N> result{};
+	std::size_t current_empty = 0;
+	for (std::size_t i = 0; i < count; i++) {
+		if (i + 1 < count && tiles[i] == tiles[i + 1] && tiles[i] < max_value) {
+			result[current_empty] = tiles[i] + 1;
+			score += 1u << result[current_empty];
+			reached_win = reached_win || result[current_empty] == win_value;
+			i++;
+		} else {
+			result[current_empty] = tiles[i];
+		}
+		current_empty++;
+	}
+
+	cells = result;
+}
+
+// Index of the jth cell of a line, counting from the side the move slides towards
+template <std::size_t N>
+constexpr std::size_t line_index(Move move, std::size_t line, std::size_t j) {
+	switch (move) {
+		case Move::Left: return N * line + j;
+		case Move::Right: return N * line + N - 1 - j;
+		case Move::Up: return N * j + line;
+		case Move::Down: return N * (N - 1 - j) + line;
+	}
+	return 0;
+}
+
+template <std::size_t N>
+std::uint32_t reverse_row(std::uint32_t row) {
+	std::uint32_t result = 0;
+	for (std::size_t i = 0; i < N; i++) {
+		result |= ((row >> (4 * i)) & 0xF) << (4 * (N - 1 - i));
+	}
+	return result;
+}
+
+struct RowResult {
+	std::uint16_t row;
+	bool reached_win;
+	unsigned score;
+};
+
+// Every possible row of a packed board, moved left and right
+template <std::size_t N>
+struct RowTables {
+	static constexpr std::size_t bits = 4 * N;
+
+	std::vector<RowResult> left;
+	std::vector<RowResult> right;
+	std::vector<std::uint16_t> reversed;
+
+	RowTables()
+	: left(1 << bits)
+	, right(1 << bits)
+	, reversed(1 << bits) {
+		for (std::uint32_t row = 0; row < (1u << bits); row++) {
+			std::array<unsigned, N> cells;
+			for (std::size_t i = 0; i < N; i++) {
+				cells[i] = (row >> (4 * i)) & 0xF;
+			}
+
+			RowResult result{0, false, 0};
+			slide_line<N>(cells, result.score, result.reached_win);
+
+			std::uint32_t moved_row = 0;
+			for (std::size_t i = 0; i < N; i++) {
+				moved_row |= cells[i] << (4 * i);
+			}
+
+			result.row = static_cast<std::uint16_t>(moved_row);
+			left[row] = result;
+
+			result.row = static_cast<std::uint16_t>(reverse_row<N>(moved_row));
+			right[reverse_row<N>(row)] = result;
+
+			reversed[row] = static_cast<std::uint16_t>(reverse_row<N>(row));
+		}
+	}
+};
+
+template <std::size_t N>
+const RowTables<N> & row_tables() {
+	static const RowTables<N> tables;
+	return tables;
+}
+
+// Lines of bigger boards slide a few cells at a time, with the tile that is
+// still waiting for a partner carried from one chunk to the next
+constexpr std::size_t chunk_cells = 3;
+constexpr std::size_t chunk_bits = 4 * chunk_cells;
+
+struct ChunkResult {
+	// the tiles that are settled, packed from the first nibble on
+	std::uint16_t cells;
+	std::uint8_t count;
+	// the last tile, which can still merge with the first of the next chunk
+	std::uint8_t waiting;
+	bool reached_win;
+	unsigned score;
+};
+
+// Every chunk of three cells, indexed by the waiting tile above the cells,
+// slid the same way as slide_line. 64K entries, so it stays in cache
+struct ChunkTable {
+	std::vector<ChunkResult> chunks;
+
+	ChunkTable()
+	: chunks(std::size_t{16} << chunk_bits) {
+		for (std::uint32_t index = 0; index < chunks.size(); index++) {
+			ChunkResult result{0, 0, static_cast<std::uint8_t>(index >> chunk_bits), false, 0};
+			for (std::size_t i = 0; i < chunk_cells; i++) {
+				auto tile = (index >> (4 * i)) & 0xF;
+				if (!tile) {
+					continue;
+				}
+
+				if (tile == result.waiting && tile < max_value) {
+					auto merged = tile + 1;
+					result.cells |= static_cast<std::uint16_t>(merged << (4 * result.count++));
+					result.score += 1u << merged;
+					result.reached_win = result.reached_win || merged == win_value;
+					result.waiting = 0;
+				} else {
+					if (result.waiting) {
+						result.cells |= static_cast<std::uint16_t>(result.waiting << (4 * result.count++));
+					}
+					result.waiting = static_cast<std::uint8_t>(tile);
+				}
+			}
+			chunks[index] = result;
+		}
+	}
+};
+
+const ChunkTable & chunk_table() {
+	static const ChunkTable table;
+	return table;
+}
+
+// Slides every line of an unpacked board, a chunk at a time
+template <std::size_t N, Move M>
+void slide_lines(const std::uint8_t * from, std::uint8_t * to, unsigned & score, bool & reached_win) {
+	const auto & chunks = chunk_table().chunks;
+
+	for (std::size_t i = 0; i < N; i++) {
+		// up to eight cells, so the slid line fits in 32 bits
+		std::uint32_t line = 0;
+		unsigned count = 0;
+		unsigned waiting = 0;
+		for (std::size_t j = 0; j < N; j += chunk_cells) {
+			std::uint32_t index = waiting << chunk_bits;
+			for (std::size_t k = 0; k < chunk_cells && j + k < N; k++) {
+				index |= std::uint32_t{from[line_index<N>(M, i, j + k)]} << (4 * k);
+			}
+
+			const auto & chunk = chunks[index];
+			line |= std::uint32_t{chunk.cells} << (4 * count);
+			count += chunk.count;
+			waiting = chunk.waiting;
+			score += chunk.score;
+			reached_win = reached_win || chunk.reached_win;
+		}
+		line |= waiting << (4 * count);
+
+		for (std::size_t j = 0; j < N; j++) {
+			to[line_index<N>(M, i, j)] = static_cast<std::uint8_t>((line >> (4 * j)) & 0xF);
+		}
+	}
+}
+
+}
+
+template <std::size_t N>
+unsigned BasicBoard<N>::get(std::size_t x, std::size_t y) const {
+	if constexpr (packed) {
+		return static_cast<unsigned>((m_cells >> (4 * (N * y + x))) & 0xF);
+	} else {
+		return m_cells[N * y + x];
+	}
+}
+
+template <std::size_t N>
+void BasicBoard<N>::set(std::size_t x, std::size_t y, unsigned value) {
+	if constexpr (packed) {
+		auto shift = 4 * (N * y + x);
+		m_cells &= ~(std::uint64_t{0xF} << shift);
+		m_cells |= std::uint64_t{value & 0xF} << shift;
+	} else {
+		m_cells[N * y + x] = static_cast<std::uint8_t>(value);
+	}
+}
+
+template <std::size_t N>
+std::uint64_t BasicBoard<N>::key() const {
+	if constexpr (packed) {
+		return m_cells;
+	} else {
+		std::uint64_t key = N;
+		for (std::size_t i = 0; i < N * N; i += 8) {
+			std::uint64_t word = 0;
+			for (std::size_t j = 0; j < 8 && i + j < N * N; j++) {
+				word |= std::uint64_t{m_cells[i + j]} << (8 * j);
+			}
+			key = hash_cells(key ^ word);
+		}
+		return key;
+	}
+}
+
+template <std::size_t N>
+unsigned BasicBoard<N>::count_empty() const {
+	unsigned empty = 0;
+	for (std::size_t i = 0; i < N * N; i++) {
+		if constexpr (packed) {
+			empty += ((m_cells >> (4 * i)) & 0xF) == 0;
+		} else {
+			empty += m_cells[i] == 0;
+		}
+	}
+	return empty;
+}
+
+template <std::size_t N>
+unsigned BasicBoard<N>::max_tile() const {
+	unsigned max = 0;
+	for (std::size_t i = 0; i < N * N; i++) {
+		if constexpr (packed) {
+			max = std::max(max, static_cast<unsigned>((m_cells >> (4 * i)) & 0xF));
+		} else {
+			max = std::max(max, static_cast<unsigned>(m_cells[i]));
+		}
+	}
+	return max;
+}
+
+template <std::size_t N>
+BasicBoard<N> BasicBoard<N>::transpose() const {
+	if constexpr (N == 4) {
+		auto x = m_cells;
+		auto a1 = x & 0xF0F00F0FF0F00F0Full;
+		auto a2 = x & 0x0000F0F00000F0F0ull;
+		auto a3 = x & 0x0F0F00000F0F0000ull;
+		auto a = a1 | (a2 << 12) | (a3 >> 12);
+		auto b1 = a & 0xFF00FF0000FF00FFull;
+		auto b2 = a & 0x00FF00FF00000000ull;
+		auto b3 = a & 0x00000000FF00FF00ull;
+		return b1 | (b2 >> 24) | (b3 << 24);
+	} else {
+		BasicBoard result;
+		for (std::size_t x = 0; x < N; x++) {
+			for (std::size_t y = 0; y < N; y++) {
+				result.set(y, x, get(x, y));
+			}
+		}
+		return result;
+	}
+}
+
+template <std::size_t N>
+BasicBoard<N> BasicBoard<N>::transformed(Symmetry symmetry) const {
+	if constexpr (packed) {
+		constexpr std::uint64_t row_mask = (1u << (4 * N)) - 1;
+		const auto & reversed = row_tables<N>().reversed;
+
+		// mirroring reverses the cells in each row, or the order of the rows
+		std::uint64_t cells = 0;
+		for (std::size_t i = 0; i < N; i++) {
+			std::uint64_t row = (m_cells >> (4 * N * i)) & row_mask;
+			if (symmetry & mirror_x) {
+				row = reversed[row];
+			}
+			cells |= row << (4 * N * (symmetry & mirror_y ? N - 1 - i : i));
+		}
+
+		return symmetry & swap_xy ? BasicBoard(cells).transpose() : BasicBoard(cells);
+	} else {
+		BasicBoard result;
+		for (std::size_t y = 0; y < N; y++) {
+			for (std::size_t x = 0; x < N; x++) {
+				auto to_x = symmetry & mirror_x ? N - 1 - x : x;
+				auto to_y = symmetry & mirror_y ? N - 1 - y : y;
+				if (symmetry & swap_xy) {
+					std::swap(to_x, to_y);
+				}
+				result.m_cells[N * to_y + to_x] = m_cells[N * y + x];
+			}
+		}
+		return result;
+	}
+}
+
+template <std::size_t N>
+typename BasicBoard<N>::Canonical BasicBoard<N>::canonical() const {
+	// the version with the smallest key, which for packed boards is the board itself
+	Canonical best{*this, 0};
+	auto best_key = key();
+	for (Symmetry symmetry = 1; symmetry < symmetry_count; symmetry++) {
+		auto board = transformed(symmetry);
+		auto board_key = board.key();
+		if (board_key < best_key) {
+			best = {board, symmetry};
+			best_key = board_key;
+		}
+	}
+	return best;
+}
+
+template <std::size_t N>
+std::uint64_t BasicBoard<N>::canonical_key() const {
+	if constexpr (N == 4) {
+		// the search looks this up at every chance node, so the four mirrorings
+		// are swaps of whole nibbles and rows rather than row lookups
+		auto x = m_cells;
+		auto mirrored_x = ((x & 0xF000F000F000F000ull) >> 12) | ((x & 0x0F000F000F000F00ull) >> 4) |
+			((x & 0x00F000F000F000F0ull) << 4) | ((x & 0x000F000F000F000Full) << 12);
+		auto mirror_rows = [](std::uint64_t cells) {
+			return (cells >> 48) | ((cells >> 16) & 0xFFFF0000ull) | ((cells << 16) & 0xFFFF00000000ull) | (cells << 48);
+		};
+
+		std::array<std::uint64_t, symmetry_count> keys;
+		keys[0] = x;
+		keys[mirror_x] = mirrored_x;
+		keys[mirror_y] = mirror_rows(x);
+		keys[mirror_x | mirror_y] = mirror_rows(mirrored_x);
+		for (Symmetry symmetry = 0; symmetry < swap_xy; symmetry++) {
+			keys[symmetry | swap_xy] = BasicBoard(keys[symmetry]).transpose().m_cells;
+		}
+		return *std::min_element(keys.begin(), keys.end());
+	} else if constexpr (packed) {
+		return canonical().board.m_cells;
+	} else {
+		return canonical().board.key();
+	}
+}
+
+template <std::size_t N>
+unsigned BasicBoard<N>::legal_moves() const {
+	unsigned legal = 0;
+	for (auto move : all_moves) {
+		if (moved(move).board != *this) {
+			legal |= move_bit(move);
+		}
+	}
+	return legal;
+}
+
+template <std::size_t N>
+typename BasicBoard<N>::MoveResult BasicBoard<N>::moved(Move move) const {
+	MoveResult result{{}, 0, false};
+
+	if constexpr (packed) {
+		const auto & tables = row_tables<N>();
+		constexpr std::uint64_t row_mask = (1u << (4 * N)) - 1;
+
+		bool vertical = move == Move::Up || move == Move::Down;
+		bool positive = move == Move::Up || move == Move::Left;
+
+		auto source = vertical ? transpose().m_cells : m_cells;
+		const auto & table = positive ? tables.left : tables.right;
+
+		std::uint64_t cells = 0;
+		for (std::size_t i = 0; i < N; i++) {
+			const auto & row = table[(source >> (4 * N * i)) & row_mask];
+			cells |= std::uint64_t{row.row} << (4 * N * i);
+			result.score += row.score;
+			result.reached_win = result.reached_win || row.reached_win;
+		}
+
+		result.board = vertical ? BasicBoard(cells).transpose() : BasicBoard(cells);
+	} else {
+		// one switch per move rather than per cell
+		auto from = m_cells.data();
+		auto to = result.board.m_cells.data();
+		switch (move) {
+			case Move::Up: slide_lines<N, Move::Up>(from, to, result.score, result.reached_win); break;
+			case Move::Left: slide_lines<N, Move::Left>(from, to, result.score, result.reached_win); break;
+			case Move::Down: slide_lines<N, Move::Down>(from, to, result.score, result.reached_win); break;
+			case Move::Right: slide_lines<N, Move::Right>(from, to, result.score, result.reached_win); break;
+		}
+	}
+
+	return result;
+}
+
+template <std::size_t N>
+bool BasicBoard<N>::operator==(const BasicBoard & other) const {
+	return m_cells == other.m_cells;
+}
+
+template <std::size_t N>
+bool BasicBoard<N>::operator!=(const BasicBoard & other) const {
+	return m_cells != other.m_cells;
+}
+
+template class BasicBoard<3>;
+template class BasicBoard<4>;
+template class BasicBoard<5>;
+template class BasicBoard<6>;
+template class BasicBoard<7>;
+template class BasicBoard<8>;
@@ -0,0 +1,174 @@
+// SPDX-FileCopyrightText: 2022 metaquarx <metaquarx@protonmail.com>
+// SPDX-License-Identifier: GPL-3.0-only
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+enum class Move {
+	Up, Left, Down, Right
+};
+
+constexpr std::array<Move, 4> all_moves{Move::Up, Move::Left, Move::Down, Move::Right};
+
+// Bit of a move in a legal move mask
+constexpr unsigned move_bit(Move move) {
+	return 1u << static_cast<unsigned>(move);
+}
+
+// Tiles are stored as exponents, the same way Tile::get_value does (1 = 2, 11 = 2048)
+constexpr unsigned win_value = 11;
+// The biggest tile on any board size, 32768. Two of them don't merge, so every
+// cell fits in a nibble
+constexpr unsigned max_value = 15;
+
+// Spreads packed boards evenly over hash tables
+constexpr std::uint64_t hash_cells(std::uint64_t cells) {
+	cells ^= cells >> 33;
+	cells *= 0xFF51AFD7ED558CCDull;
+	cells ^= cells >> 33;
+	cells *= 0xC4CEB9FE1A85EC53ull;
+	cells ^= cells >> 33;
+	return cells;
+}
+
+// Steps a random state and returns the next number from it. Unlike the
+// standard engines and distributions this is the same on every platform, so a
+// seed plays the same game everywhere
+constexpr std::uint64_t next_random(std::uint64_t & state) {
+	state += 0x9E3779B97F4A7C15ull;
+	return hash_cells(state);
+}
+
+// The spawn rule every game follows: a 2 or a 4 with equal odds, on any empty
+// cell with equal odds. One number from next_random picks both, the top bit
+// the value and the low 32 bits, scaled down, which of the empty cells
+// counting row by row from the top left.
+struct SpawnPick {
+	unsigned value;
+	std::size_t empty_index;
+};
+
+constexpr SpawnPick pick_spawn(std::uint64_t random, std::size_t empty_count) {
+	return {(random >> 63) ? 2u : 1u, static_cast<std::size_t>(((random & 0xFFFFFFFF) * empty_count) >> 32)};
+}
+
+// One of the eight rotations and reflections of a square board, as three
+// steps taken in order: mirror left to right, mirror top to bottom, transpose.
+// Every symmetric version of a board is worth the same and has the same moves,
+// relabelled.
+using Symmetry = unsigned;
+
+constexpr Symmetry mirror_x = 1;
+constexpr Symmetry mirror_y = 2;
+constexpr Symmetry swap_xy = 4;
+constexpr unsigned symmetry_count = 8;
+
+// The symmetry that undoes the given one. Mirroring then transposing is
+// undone by transposing first, which is the same as mirroring the other axis
+constexpr Symmetry inverse_symmetry(Symmetry symmetry) {
+	if (symmetry & swap_xy) {
+		return swap_xy | ((symmetry & mirror_x) << 1) | ((symmetry & mirror_y) >> 1);
+	}
+	return symmetry;
+}
+
+// The move that does to a transformed board what move does to the original
+constexpr Move transformed_move(Move move, Symmetry symmetry) {
+	if (symmetry & mirror_x) {
+		move = move == Move::Left ? Move::Right : move == Move::Right ? Move::Left : move;
+	}
+	if (symmetry & mirror_y) {
+		move = move == Move::Up ? Move::Down : move == Move::Down ? Move::Up : move;
+	}
+	if (symmetry & swap_xy) {
+		constexpr Move swapped[] = {Move::Left, Move::Up, Move::Right, Move::Down};
+		move = swapped[static_cast<unsigned>(move)];
+	}
+	return move;
+}
+
+constexpr std::size_t min_board_size = 3;
+constexpr std::size_t max_board_size = 8;
+
+// An NxN board.
+//
+// 3x3 and 4x4 boards are packed into 64 bits, one nibble per cell, with cell
+// (x, y) in nibble N * y + x. Every row is then a single 12 or 16 bit word,
+// and moves are one table lookup per row.
+// Bigger boards don't fit in 64 bits, so they keep a byte per cell instead.
+// Their lines slide three cells per lookup, carrying any tile that could still
+// merge into the next lookup: two per line on 5x5 and 6x6 boards. Cells still
+// stop at max_value, as on packed boards.
+template <std::size_t N>
+class BasicBoard {
+public:
+	static_assert(N >= min_board_size && N <= max_board_size, "Boards go from 3x3 to 8x8");
+
+	static constexpr std::size_t size = N;
+	static constexpr bool packed = N <= 4;
+
+	constexpr BasicBoard() : m_cells{} {}
+
+	template <bool P = packed, std::enable_if_t<P, int> = 0>
+	constexpr BasicBoard(std::uint64_t cells) : m_cells(cells) {}
+
+	unsigned get(std::size_t x, std::size_t y) const;
+	void set(std::size_t x, std::size_t y, unsigned value);
+
+	template <bool P = packed, std::enable_if_t<P, int> = 0>
+	std::uint64_t raw() const {
+		return m_cells;
+	}
+
+	// Identifies the board in hash tables: the packed cells themselves when
+	// they fit, a hash of them when they don't
+	std::uint64_t key() const;
+
+	unsigned count_empty() const;
+	unsigned max_tile() const;
+	BasicBoard transpose() const;
+	BasicBoard transformed(Symmetry symmetry) const;
+	unsigned legal_moves() const;
+
+	// The one version of the board all eight of its symmetries share, so
+	// caches can store each of them once
+	struct Canonical;
+	Canonical canonical() const;
+	std::uint64_t canonical_key() const;
+
+	struct MoveResult;
+	MoveResult moved(Move move) const;
+
+	bool operator==(const BasicBoard & other) const;
+	bool operator!=(const BasicBoard & other) const;
+
+private:
+	std::conditional_t<packed, std::uint64_t, std::array<std::uint8_t, N * N>> m_cells;
+};
+
+template <std::size_t N>
+struct BasicBoard<N>::MoveResult {
+	BasicBoard board;
+	unsigned score;
+	bool reached_win;
+};
+
+template <std::size_t N>
+struct BasicBoard<N>::Canonical {
+	BasicBoard board;
+	// takes this board to the canonical one
+	Symmetry symmetry;
+};
+
+using Board = BasicBoard<4>;
+
+extern template class BasicBoard<3>;
+extern template class BasicBoard<4>;
+extern template class BasicBoard<5>;
+extern template class BasicBoard<6>;
+extern template class BasicBoard<7>;
+extern template class BasicBoard<8>;
@@ -0,0 +1,358 @@
+// SPDX-FileCopyrightText: 2022 metaquarx <metaquarx@protonmail.com>
+// SPDX-License-Identifier: GPL-3.0-only
+
+#include "Dataset.hpp"
+
+#include <array>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <stdexcept>
+#include <utility>
+
+#ifdef TFE_HAS_ZLIB
+#include <zlib.h>
+#endif
+
+namespace {
+
+constexpr std::array<char, 8> shard_magic{'T', 'F', 'E', 'S', 'H', 'A', 'R', 'D'};
+constexpr std::uint32_t shard_version = 1;
+constexpr std::uint32_t compressed_flag = 1;
+
+// bytes per record of each column, in the order they are stored
+constexpr std::array<std::size_t, 5> column_widths{
+	sizeof(std::uint64_t), sizeof(std::uint32_t), sizeof(float), sizeof(std::uint8_t), sizeof(std::uint8_t)
+};
+constexpr std::size_t record_bytes = 8 + 4 + 4 + 1 + 1;
+
+struct Header {
+	std::array<char, 8> magic;
+	std::uint32_t version;
+	std::uint32_t board_size;
+	std::uint32_t flags;
+	std::uint32_t reserved;
+	std::uint64_t count;
+	// bytes each column takes up in the file, which only differs from
+	// count * width when compressed
+	std::array<std::uint64_t, 5> column_sizes;
+	std::array<std::uint64_t, 3> padding;
+};
+static_assert(sizeof(Header) == 96);
+
+std::string shard_path(const std::string & prefix, std::size_t index) {
+	char number[32];
+	std::snprintf(number, sizeof(number), "-%05zu.shard", index);
+	return prefix + number;
+}
+
+}
+
+DatasetWriter::DatasetWriter(std::string prefix, std::size_t board_size, std::size_t shard_records, bool compress)
+: m_prefix(std::move(prefix))
+, m_board_size(board_size)
+, m_shard_records(shard_records)
+, m_compress(compress)
+, m_shard_count(0)
+, m_finished(false)
+, m_back_pending(false)
+, m_stopping(false) {
+	if (board_size != 3 && board_size != 4) {
+		throw std::invalid_argument("Datasets only hold packed 3x3 and 4x4 boards");
+	}
+	if (!shard_records) {
+		throw std::invalid_argument("Shards need room for at least one record");
+	}
+	if (compress && !compression_available()) {
+		throw std::invalid_argument("Built without zlib, shards can't be compressed");
+	}
+
+	m_front.reserve(shard_records);
+	m_back.reserve(shard_records);
+	m_thread = std::thread([this] { write_loop(); });
+}
+
+DatasetWriter::~DatasetWriter() {
+	try {
+		finish();
+	} catch (...) {
+		// nowhere to report it from a destructor, call finish() to see errors
+	}
+}
+
+void DatasetWriter::add(const DatasetRecord & record) {
+	if (m_finished) {
+		throw std::logic_error("Dataset already finished");
+	}
+
+	m_front.boards.push_back(record.board);
+	m_front.final_scores.push_back(record.final_score);
+	m_front.rewards.push_back(record.reward);
+	m_front.legal_moves.push_back(record.legal_moves);
+	m_front.moves.push_back(record.move);
+
+	if (m_front.size() == m_shard_records) {
+		flush();
+	}
+}
+
+void DatasetWriter::finish() {
+	if (m_finished) {
+		return;
+	}
+
+	m_finished = true;
+	std::exception_ptr failure;
+	try {
+		flush();
+	} catch (...) {
+		failure = std::current_exception();
+	}
+
+	{
+		std::lock_guard lock(m_mutex);
+		m_stopping = true;
+	}
+	m_condition.notify_all();
+	m_thread.join();
+
+	if (failure) {
+		std::rethrow_exception(failure);
+	}
+	if (m_error) {
+		throw std::runtime_error(*m_error);
+	}
+}
+
+std::size_t DatasetWriter::get_shard_count() const {
+	return m_shard_count;
+}
+
+bool DatasetWriter::compression_available() {
+#ifdef TFE_HAS_ZLIB
+	return true;
+#else
+	return false;
+#endif
+}
+
+void DatasetWriter::Columns::reserve(std::size_t count) {
+	boards.reserve(count);
+	final_scores.reserve(count);
+	rewards.reserve(count);
+	legal_moves.reserve(count);
+	moves.reserve(count);
+}
+
+void DatasetWriter::Columns::clear() {
+	boards.clear();
+	final_scores.clear();
+	rewards.clear();
+	legal_moves.clear();
+	moves.clear();
+}
+
+std::size_t DatasetWriter::Columns::size() const {
+	return boards.size();
+}
+
+void DatasetWriter::flush() {
+	if (!m_front.size()) {
+		return;
+	}
+
+	std::unique_lock lock(m_mutex);
+	m_condition.wait(lock, [&] { return !m_back_pending; });
+	if (m_error) {
+		throw std::runtime_error(*m_error);
+	}
+
+	// the vectors keep their capacity through the swap, so neither buffer
+	// allocates again after the first shard
+	std::swap(m_front, m_back);
+	m_back_pending = true;
+	m_shard_count++;
+	lock.unlock();
+	m_condition.notify_all();
+
+	m_front.clear();
+}
+
+void DatasetWriter::write_loop() {
+	std::unique_lock lock(m_mutex);
+	std::size_t index = 0;
+	while (true) {
+		m_condition.wait(lock, [&] { return m_back_pending || m_stopping; });
+		if (!m_back_pending) {
+			return;
+		}
+
+		// the producer leaves m_back alone until m_back_pending is cleared
+		lock.unlock();
+		std::optional<std::string> error;
+		try {
+			write_shard(m_back, index++);
+		} catch (const std::exception & e) {
+			error = e.what();
+		}
+		lock.lock();
+
+		if (error && !m_error) {
+			m_error = error;
+		}
+		m_back_pending = false;
+		m_condition.notify_all();
+	}
+}
+
+void DatasetWriter::write_shard(const Columns & columns, std::size_t index) const {
+	auto count = columns.size();
+	std::array<std::pair<const void *, std::size_t>, 5> raw{{
+		{columns.boards.data(), count * column_widths[0]},
+		{columns.final_scores.data(), count * column_widths[1]},
+		{columns.rewards.data(), count * column_widths[2]},
+		{columns.legal_moves.data(), count * column_widths[3]},
+		{columns.moves.data(), count * column_widths[4]},
+	}};
+
+	Header header{};
+	header.magic = shard_magic;
+	header.version = shard_version;
+	header.board_size = static_cast<std::uint32_t>(m_board_size);
+	header.flags = m_compress ? compressed_flag : 0;
+	header.count = count;
+
+	std::array<std::vector<unsigned char>, 5> deflated;
+	for (std::size_t i = 0; i < raw.size(); i++) {
+		if (!m_compress) {
+			header.column_sizes[i] = raw[i].second;
+			continue;
+		}
+
+#ifdef TFE_HAS_ZLIB
+		// the fastest level, the writer has to keep up with the players
+		auto length = compressBound(static_cast<uLong>(raw[i].second));
+		deflated[i].resize(length);
+		if (compress2(deflated[i].data(), &length, static_cast<const Bytef *>(raw[i].first), static_cast<uLong>(raw[i].second), 1) != Z_OK) {
+			throw std::runtime_error("Unable to compress shard " + shard_path(m_prefix, index));
+		}
+		deflated[i].resize(length);
+		header.column_sizes[i] = length;
+#endif
+	}
+
+	// written under a temporary name so readers never see half a shard
+	auto path = shard_path(m_prefix, index);
+	auto partial = path + ".partial";
+	{
+		std::ofstream file(partial, std::ios::binary | std::ios::trunc);
+		file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+		for (std::size_t i = 0; i < raw.size(); i++) {
+			auto data = m_compress ? static_cast<const void *>(deflated[i].data()) : raw[i].first;
+			file.write(static_cast<const char *>(data), static_cast<std::streamsize>(header.column_sizes[i]));
+		}
+		if (!file) {
+			throw std::runtime_error("Unable to write " + partial);
+		}
+	}
+
+	if (std::rename(partial.c_str(), path.c_str()) != 0) {
+		throw std::runtime_error("Unable to write " + path);
+	}
+}
+
+DatasetShard::DatasetShard(const std::string & path)
+: m_file(path) {
+	Header header;
+	if (m_file.get_size() < sizeof(header)) {
+		throw std::runtime_error("Not a dataset shard: " + path);
+	}
+	std::memcpy(&header, m_file.get_data(), sizeof(header));
+
+	if (header.magic != shard_magic || header.version != shard_version) {
+		throw std::runtime_error("Not a dataset shard: " + path);
+	}
+
+	std::uint64_t stored = 0;
+	for (auto size : header.column_sizes) {
+		stored += size;
+	}
+	if (m_file.get_size() != sizeof(header) + stored) {
+		throw std::runtime_error("Truncated dataset shard: " + path);
+	}
+
+	m_board_size = header.board_size;
+	m_count = header.count;
+
+	auto data = m_file.get_data() + sizeof(header);
+	if (header.flags & compressed_flag) {
+#ifdef TFE_HAS_ZLIB
+		m_inflated.resize(m_count * record_bytes);
+		auto input = data;
+		auto output = m_inflated.data();
+		for (std::size_t i = 0; i < column_widths.size(); i++) {
+			auto expected = static_cast<uLongf>(m_count * column_widths[i]);
+			auto length = expected;
+			if (uncompress(reinterpret_cast<Bytef *>(output), &length, reinterpret_cast<const Bytef *>(input), static_cast<uLong>(header.column_sizes[i])) != Z_OK ||
+				length != expected) {
+				throw std::runtime_error("Corrupt dataset shard: " + path);
+			}
+			input += header.column_sizes[i];
+			output += expected;
+		}
+		data = m_inflated.data();
+#else
+		throw std::runtime_error("Built without zlib, unable to read compressed shard " + path);
+#endif
+	} else {
+		for (std::size_t i = 0; i < column_widths.size(); i++) {
+			if (header.column_sizes[i] != m_count * column_widths[i]) {
+				throw std::runtime_error("Corrupt dataset shard: " + path);
+			}
+		}
+	}
+
+	// widest columns first, so every column starts suitably aligned
+	m_boards = reinterpret_cast<const std::uint64_t *>(data);
+	data += m_count * column_widths[0];
+	m_final_scores = reinterpret_cast<const std::uint32_t *>(data);
+	data += m_count * column_widths[1];
+	m_rewards = reinterpret_cast<const float *>(data);
+	data += m_count * column_widths[2];
+	m_legal_moves = reinterpret_cast<const std::uint8_t *>(data);
+	data += m_count * column_widths[3];
+	m_moves = reinterpret_cast<const std::uint8_t *>(data);
+}
+
+std::size_t DatasetShard::get_board_size() const {
+	return m_board_size;
+}
+
+std::uint64_t DatasetShard::get_count() const {
+	return m_count;
+}
+
+const std::uint64_t * DatasetShard::get_boards() const {
+	return m_boards;
+}
+
+const std::uint32_t * DatasetShard::get_final_scores() const {
+	return m_final_scores;
+}
+
+const float * DatasetShard::get_rewards() const {
+	return m_rewards;
+}
+
+const std::uint8_t * DatasetShard::get_legal_moves() const {
+	return m_legal_moves;
+}
+
+const std::uint8_t * DatasetShard::get_moves() const {
+	return m_moves;
+}
+
+DatasetRecord DatasetShard::get_record(std::uint64_t index) const {
+	return {m_boards[index], m_legal_moves[index], m_moves[index], m_rewards[index], m_final_scores[index]};
+}
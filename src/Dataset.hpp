@@ -0,0 +1,121 @@
+// SPDX-FileCopyrightText: 2022 metaquarx <metaquarx@protonmail.com>
+// SPDX-License-Identifier: GPL-3.0-only
+
+#pragma once
+
+#include "MappedFile.hpp"
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+// One position seen while playing, for training models offline
+struct DatasetRecord {
+	// packed board, 3x3 or 4x4
+	std::uint64_t board;
+	// move_bit flags
+	std::uint8_t legal_moves;
+	// index into all_moves
+	std::uint8_t move;
+	// score gained by the move
+	float reward;
+	// score at the end of the game the position comes from
+	std::uint32_t final_score;
+};
+
+// Writes records into shard files of a fixed number of records each, named
+// <prefix>-00000.shard, <prefix>-00001.shard, ...
+//
+// Shards are columnar: every board, then every final score, reward, legal
+// move mask and move, so a reader only touches the columns it needs. Records
+// are gathered in one buffer while a background thread writes the previous
+// one out, a whole column per write. Built with zlib, each column can also
+// be deflated.
+//
+// Not thread safe, callers on several threads have to take turns.
+class DatasetWriter {
+public:
+	DatasetWriter(std::string prefix, std::size_t board_size, std::size_t shard_records = 1 << 20, bool compress = false);
+	~DatasetWriter();
+
+	DatasetWriter(const DatasetWriter &) = delete;
+	DatasetWriter & operator=(const DatasetWriter &) = delete;
+
+	void add(const DatasetRecord & record);
+	// Writes out the last, partially filled shard and waits for the writer
+	void finish();
+
+	std::size_t get_shard_count() const;
+	static bool compression_available();
+
+private:
+	struct Columns {
+		std::vector<std::uint64_t> boards;
+		std::vector<std::uint32_t> final_scores;
+		std::vector<float> rewards;
+		std::vector<std::uint8_t> legal_moves;
+		std::vector<std::uint8_t> moves;
+
+		void reserve(std::size_t count);
+		void clear();
+		std::size_t size() const;
+	};
+
+	std::string m_prefix;
+	std::size_t m_board_size;
+	std::size_t m_shard_records;
+	bool m_compress;
+	std::size_t m_shard_count;
+	bool m_finished;
+
+	// filled by add(), swapped with m_back once full
+	Columns m_front;
+	Columns m_back;
+	bool m_back_pending;
+	bool m_stopping;
+	std::optional<std::string> m_error;
+	std::mutex m_mutex;
+	std::condition_variable m_condition;
+	std::thread m_thread;
+
+	void flush();
+	void write_loop();
+	void write_shard(const Columns & columns, std::size_t index) const;
+};
+
+// A shard mapped into memory. Uncompressed columns are read straight from
+// the mapping; compressed ones are inflated once, when the shard is opened.
+class DatasetShard {
+public:
+	explicit DatasetShard(const std::string & path);
+
+	std::size_t get_board_size() const;
+	std::uint64_t get_count() const;
+
+	const std::uint64_t * get_boards() const;
+	const std::uint32_t * get_final_scores() const;
+	const float * get_rewards() const;
+	const std::uint8_t * get_legal_moves() const;
+	const std::uint8_t * get_moves() const;
+
+	DatasetRecord get_record(std::uint64_t index) const;
+
+private:
+	MappedFile m_file;
+	std::size_t m_board_size;
+	std::uint64_t m_count;
+
+	const std::uint64_t * m_boards;
+	const std::uint32_t * m_final_scores;
+	const float * m_rewards;
+	const std::uint8_t * m_legal_moves;
+	const std::uint8_t * m_moves;
+
+	// only used for compressed shards
+	std::vector<std::byte> m_inflated;
+};
@@ -0,0 +1,41 @@
+// SPDX-FileCopyrightText: 2022 metaquarx <metaquarx@protonmail.com>
+// SPDX-License-Identifier: GPL-3.0-only
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+
+// Steps something a fixed number of times per second, whatever rate it is
+// updated at.
+//
+// After a stall it catches up on at most max_lag seconds, and spends at most
+// max_work seconds per update doing so, past the first step. Steps that
+// don't fit wait for the next update, so slow steps can't hold up input and
+// drawing.
+class FixedStep {
+public:
+	static constexpr float max_lag = .25f;
+	static constexpr std::chrono::microseconds max_work{2000};
+
+	// Calls step() once for every interval seconds that have passed, until
+	// it returns false or the update runs out of time
+	template <typename F>
+	void update(float dt, float interval, F step) {
+		m_accumulator = std::min(m_accumulator + dt, max_lag);
+		auto start = std::chrono::steady_clock::now();
+		while (m_accumulator >= interval) {
+			m_accumulator -= interval;
+			if (!step() || std::chrono::steady_clock::now() - start >= max_work) {
+				break;
+			}
+		}
+	}
+
+	void reset() {
+		m_accumulator = 0.f;
+	}
+
+private:
+	float m_accumulator = 0.f;
+};
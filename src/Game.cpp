@@ -0,0 +1,165 @@
+// SPDX-FileCopyrightText: 2022 metaquarx <metaquarx@protonmail.com>
+// SPDX-License-Identifier: GPL-3.0-only
+
+#include "Game.hpp"
+
+#include <array>
+#include <cassert>
+#include <random>
+
+template <std::size_t N>
+BasicGame<N>::BasicGame()
+: BasicGame(std::random_device{}()) {
+}
+
+template <std::size_t N>
+BasicGame<N>::BasicGame(std::uint64_t seed)
+: m_score(0)
+, m_state(GameState::Ongoing)
+, m_passed(false)
+, m_legal_moves(0)
+, m_rng(seed)
+, m_position(0) {
+}
+
+template <std::size_t N>
+void BasicGame<N>::clear() {
+	m_board = {};
+	m_score = 0;
+	m_state = GameState::Ongoing;
+	m_passed = false;
+
+	spawn_new();
+	spawn_new();
+	m_legal_moves = m_board.legal_moves();
+
+	m_history.clear();
+	m_history.push_back(snapshot());
+	m_position = 0;
+}
+
+template <std::size_t N>
+bool BasicGame<N>::apply(Move move) {
+	if (!(m_legal_moves & move_bit(move))) {
+		m_last_spawn.reset();
+		return false;
+	}
+
+	auto result = m_board.moved(move);
+	m_board = result.board;
+	m_score += result.score;
+	if (result.reached_win && !m_passed) {
+		m_state = GameState::Win;
+	}
+
+	spawn_new();
+
+	m_legal_moves = m_board.legal_moves();
+	if (!m_legal_moves) {
+		m_state = GameState::Lose;
+	}
+
+	// a new move drops whatever could have been redone
+	m_history.resize(m_position + 1);
+	m_history.push_back(snapshot());
+	m_position++;
+	return true;
+}
+
+template <std::size_t N>
+void BasicGame<N>::pass() {
+	m_passed = true;
+	m_state = GameState::Ongoing;
+
+	if (m_position < m_history.size()) {
+		m_history[m_position] = snapshot();
+	}
+}
+
+template <std::size_t N>
+bool BasicGame<N>::undo() {
+	if (m_position == 0 || m_position >= m_history.size()) {
+		return false;
+	}
+
+	restore(m_history[--m_position]);
+	return true;
+}
+
+template <std::size_t N>
+bool BasicGame<N>::redo() {
+	if (m_position + 1 >= m_history.size()) {
+		return false;
+	}
+
+	restore(m_history[++m_position]);
+	return true;
+}
+
+template <std::size_t N>
+typename BasicGame<N>::Board BasicGame<N>::get_board() const {
+	return m_board;
+}
+
+template <std::size_t N>
+unsigned BasicGame<N>::get_score() const {
+	return m_score;
+}
+
+template <std::size_t N>
+GameState BasicGame<N>::get_state() const {
+	return m_state;
+}
+
+template <std::size_t N>
+unsigned BasicGame<N>::legal_moves() const {
+	return m_legal_moves;
+}
+
+template <std::size_t N>
+std::optional<Spawn> BasicGame<N>::get_last_spawn() const {
+	return m_last_spawn;
+}
+
+template <std::size_t N>
+void BasicGame<N>::spawn_new() {
+	std::array<std::size_t, N * N> empty;
+	std::size_t empty_count = 0;
+	for (std::size_t y = 0; y < N; y++) {
+		for (std::size_t x = 0; x < N; x++) {
+			if (!m_board.get(x, y)) {
+				empty[empty_count++] = N * y + x;
+			}
+		}
+	}
+	assert(empty_count);
+
+	auto pick = pick_spawn(next_random(m_rng), empty_count);
+	auto new_location = empty[pick.empty_index];
+
+	m_last_spawn = Spawn{new_location % N, new_location / N, pick.value};
+	m_board.set(m_last_spawn->x, m_last_spawn->y, pick.value);
+}
+
+template <std::size_t N>
+typename BasicGame<N>::Snapshot BasicGame<N>::snapshot() const {
+	return {m_board, m_score, m_state, m_passed, m_legal_moves, m_rng};
+}
+
+template <std::size_t N>
+void BasicGame<N>::restore(const Snapshot & snapshot) {
+	m_board = snapshot.board;
+	m_score = snapshot.score;
+	m_state = snapshot.state;
+	m_passed = snapshot.passed;
+	m_legal_moves = snapshot.legal_moves;
+	m_rng = snapshot.rng;
+	m_last_spawn.reset();
+}
+
+template class BasicGame<3>;
+template class BasicGame<4>;
+template class BasicGame<5>;
+template class BasicGame<6>;
+template class BasicGame<7>;
+template class BasicGame<8>;
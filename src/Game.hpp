@@ -0,0 +1,85 @@
+// SPDX-FileCopyrightText: 2022 metaquarx <metaquarx@protonmail.com>
+// SPDX-License-Identifier: GPL-3.0-only
+
+#pragma once
+
+#include "Board.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+enum class GameState {Ongoing, Win, Lose};
+
+struct Spawn {
+	std::size_t x;
+	std::size_t y;
+	unsigned value;
+};
+
+// Headless game logic: no tiles, no animations, just the packed board.
+// Grid drives one of these for the player, and autoplay can step it as fast
+// as the CPU allows. The state and legal moves are worked out once per move,
+// so asking for them is free.
+//
+// Every move leaves a snapshot of the board, score and random engine behind,
+// a couple dozen bytes each, so any number of moves can be undone and redone
+// without replaying the game from the start.
+template <std::size_t N>
+class BasicGame {
+public:
+	using Board = BasicBoard<N>;
+
+	BasicGame();
+	explicit BasicGame(std::uint64_t seed);
+
+	void clear();
+	bool apply(Move move);
+	void pass();
+
+	bool undo();
+	bool redo();
+
+	Board get_board() const;
+	unsigned get_score() const;
+	GameState get_state() const;
+	// Moves that would change the board, as move_bit flags
+	unsigned legal_moves() const;
+	std::optional<Spawn> get_last_spawn() const;
+
+private:
+	Board m_board;
+	unsigned m_score;
+	GameState m_state;
+	bool m_passed;
+	unsigned m_legal_moves;
+	std::optional<Spawn> m_last_spawn;
+	// state for next_random
+	std::uint64_t m_rng;
+
+	struct Snapshot {
+		Board board;
+		unsigned score;
+		GameState state;
+		bool passed;
+		unsigned legal_moves;
+		std::uint64_t rng;
+	};
+	// every position of the current game, the one on the board at m_position
+	std::vector<Snapshot> m_history;
+	std::size_t m_position;
+
+	void spawn_new();
+	Snapshot snapshot() const;
+	void restore(const Snapshot & snapshot);
+};
+
+using Game = BasicGame<4>;
+
+extern template class BasicGame<3>;
+extern template class BasicGame<4>;
+extern template class BasicGame<5>;
+extern template class BasicGame<6>;
+extern template class BasicGame<7>;
+extern template class BasicGame<8>;
@@ -0,0 +1,120 @@
+// SPDX-FileCopyrightText: 2022 metaquarx <metaquarx@protonmail.com>
+// SPDX-License-Identifier: GPL-3.0-only
+
+#include "GameBatch.hpp"
+
+#include <algorithm>
+#include <bitset>
+
+namespace {
+
+// Games per piece of work handed to a thread, enough that waking it is worth it
+constexpr std::size_t games_per_range = 1024;
+
+void write_observation(std::uint64_t board, std::uint8_t * observation) {
+	for (std::size_t i = 0; i < GameBatch::observation_size; i++) {
+		observation[i] = static_cast<std::uint8_t>((board >> (4 * i)) & 0xF);
+	}
+}
+
+}
+
+GameBatch::GameBatch(std::size_t count, std::uint64_t seed, unsigned threads)
+: m_boards(count)
+, m_scores(count)
+, m_legal_moves(count)
+, m_rng(count)
+, m_pool(std::max(threads, 1u)) {
+	for (std::size_t i = 0; i < count; i++) {
+		m_rng[i] = hash_cells(seed ^ hash_cells(i + 1));
+	}
+}
+
+std::size_t GameBatch::size() const {
+	return m_boards.size();
+}
+
+void GameBatch::reset(std::uint8_t * observations) {
+	for_each_range([&](std::size_t begin, std::size_t end) {
+		for (std::size_t i = begin; i < end; i++) {
+			start(i);
+			write_observation(m_boards[i], observations + i * observation_size);
+		}
+	});
+}
+
+void GameBatch::step(const std::uint8_t * actions, std::uint8_t * observations, float * rewards, std::uint8_t * dones,
+	std::uint32_t * final_scores, std::uint64_t * final_boards) {
+	for_each_range([&](std::size_t begin, std::size_t end) {
+		for (std::size_t i = begin; i < end; i++) {
+			rewards[i] = 0.f;
+			dones[i] = 0;
+
+			auto action = actions[i];
+			if (action < all_moves.size() && (m_legal_moves[i] & move_bit(all_moves[action]))) {
+				auto result = Board(m_boards[i]).moved(all_moves[action]);
+				m_boards[i] = result.board.raw();
+				m_scores[i] += result.score;
+				rewards[i] = static_cast<float>(result.score);
+
+				spawn(i);
+				m_legal_moves[i] = static_cast<std::uint8_t>(Board(m_boards[i]).legal_moves());
+			}
+
+			if (final_scores) {
+				final_scores[i] = m_scores[i];
+			}
+			if (final_boards) {
+				final_boards[i] = m_boards[i];
+			}
+			if (!m_legal_moves[i]) {
+				dones[i] = 1;
+				start(i);
+			}
+
+			write_observation(m_boards[i], observations + i * observation_size);
+		}
+	});
+}
+
+const std::uint64_t * GameBatch::get_boards() const {
+	return m_boards.data();
+}
+
+const std::uint32_t * GameBatch::get_scores() const {
+	return m_scores.data();
+}
+
+const std::uint8_t * GameBatch::get_legal_moves() const {
+	return m_legal_moves.data();
+}
+
+template <typename F>
+void GameBatch::for_each_range(F function) {
+	auto ranges = (size() + games_per_range - 1) / games_per_range;
+	m_pool.run(ranges, [&](std::size_t range) {
+		function(range * games_per_range, std::min(size(), (range + 1) * games_per_range));
+	});
+}
+
+void GameBatch::start(std::size_t game) {
+	m_boards[game] = 0;
+	m_scores[game] = 0;
+	spawn(game);
+	spawn(game);
+	m_legal_moves[game] = static_cast<std::uint8_t>(Board(m_boards[game]).legal_moves());
+}
+
+void GameBatch::spawn(std::size_t game) {
+	auto board = m_boards[game];
+	// one bit per empty cell, at the bottom of its nibble, which count row by row
+	auto empty = ~(board | (board >> 1) | (board >> 2) | (board >> 3)) & 0x1111111111111111ull;
+	auto count = std::bitset<64>(empty).count();
+
+	auto pick = pick_spawn(next_random(m_rng[game]), count);
+	for (std::size_t i = 0; i < pick.empty_index; i++) {
+		empty &= empty - 1;
+	}
+
+	m_boards[game] = board | (std::uint64_t{pick.value} * (empty & (~empty + 1)));
+}
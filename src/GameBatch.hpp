@@ -0,0 +1,59 @@
+// SPDX-FileCopyrightText: 2022 metaquarx <metaquarx@protonmail.com>
+// SPDX-License-Identifier: GPL-3.0-only
+
+#pragma once
+
+#include "Board.hpp"
+#include "WorkerPool.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Many independent 4x4 games stepped together, for reinforcement learning.
+//
+// Like BoardBatch every field is its own array. Each game draws its spawns
+// from its own random stream, derived from the seed and the game's index,
+// so the results don't depend on how many threads step them.
+//
+// Games that end are started over within the same step; their done flag is
+// set and the observation is already the new game's first board. How they
+// ended is only left in the final scores and boards that step can fill in.
+class GameBatch {
+public:
+	// exponents of the cells of one board, cell (x, y) at 4 * y + x
+	static constexpr std::size_t observation_size = 16;
+
+	GameBatch(std::size_t count, std::uint64_t seed, unsigned threads = 1);
+
+	std::size_t size() const;
+
+	// Starts every game over, observations holds size() * observation_size values
+	void reset(std::uint8_t * observations);
+
+	// Plays actions[i] (an index into all_moves) in game i. A move that
+	// doesn't change the board is a no-op worth no reward. Every buffer holds
+	// one value per game, observations observation_size values per game.
+	// If given, final_scores and final_boards get each game's score and packed
+	// board after its move, before a finished game starts over.
+	void step(const std::uint8_t * actions, std::uint8_t * observations, float * rewards, std::uint8_t * dones,
+		std::uint32_t * final_scores = nullptr, std::uint64_t * final_boards = nullptr);
+
+	const std::uint64_t * get_boards() const;
+	const std::uint32_t * get_scores() const;
+	// move_bit flags, for masking out moves that would do nothing
+	const std::uint8_t * get_legal_moves() const;
+
+private:
+	std::vector<std::uint64_t> m_boards;
+	std::vector<std::uint32_t> m_scores;
+	std::vector<std::uint8_t> m_legal_moves;
+	std::vector<std::uint64_t> m_rng;
+	WorkerPool m_pool;
+
+	template <typename F>
+	void for_each_range(F function);
+
+	void start(std::size_t game);
+	void spawn(std::size_t game);
+};
@@ -0,0 +1,365 @@
+// SPDX-FileCopyrightText: 2022 metaquarx <metaquarx@protonmail.com>
+// SPDX-License-Identifier: GPL-3.0-only
+
+#include "AI.hpp"
+#include "Dataset.hpp"
+#include "Game.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <new>
+#include <optional>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef TFE_HAS_FORK
+#include "SharedMemory.hpp"
+#include "SharedRing.hpp"
+
+#include <csignal>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <sys/prctl.h>
+#endif
+#endif
+
+static void usage() {
+	std::cerr <<
+		"usage: TFE-dataset play [--compress] [--processes] <games> <output prefix> [workers]\n"
+		"       TFE-dataset info <shard file>...\n";
+}
+
+// Plays a new game to the end, recording every position
+static void play_game(Game & game, const AI & ai, std::vector<DatasetRecord> & records) {
+	game.clear();
+	records.clear();
+
+	while (game.get_state() != GameState::Lose) {
+		if (game.get_state() == GameState::Win) {
+			game.pass();
+		}
+
+		auto board = game.get_board();
+		auto move = ai.choose(board);
+		if (!move) {
+			break;
+		}
+
+		auto score = game.get_score();
+		auto legal = game.legal_moves();
+		game.apply(*move);
+
+		auto index = std::find(all_moves.begin(), all_moves.end(), *move) - all_moves.begin();
+		records.push_back({board.raw(), static_cast<std::uint8_t>(legal), static_cast<std::uint8_t>(index),
+			static_cast<float>(game.get_score() - score), 0});
+	}
+
+	for (auto & record : records) {
+		record.final_score = game.get_score();
+	}
+}
+
+struct PlayResult {
+	std::uint64_t records;
+	unsigned long games;
+};
+
+static PlayResult play_in_threads(DatasetWriter & writer, unsigned long games, const Heuristic & heuristic, const std::vector<std::uint32_t> & seeds) {
+	TranspositionTable table(64 << 20);
+	std::mutex writer_mutex;
+	std::atomic<unsigned long> next_game{0};
+	std::atomic<std::uint64_t> total_records{0};
+
+	std::vector<std::thread> workers;
+	for (std::size_t i = 0; i < seeds.size(); i++) {
+		workers.emplace_back([&, i] {
+			Game game(seeds[i]);
+			AI ai(2, &table, &heuristic);
+			std::vector<DatasetRecord> records;
+
+			while (next_game++ < games) {
+				table.new_search();
+				play_game(game, ai, records);
+
+				// a whole game per lock, the writer itself only copies into its buffer
+				std::lock_guard lock(writer_mutex);
+				for (const auto & record : records) {
+					writer.add(record);
+				}
+				total_records += records.size();
+			}
+		});
+	}
+	for (auto & worker : workers) {
+		worker.join();
+	}
+
+	return {total_records, games};
+}
+
+#ifdef TFE_HAS_FORK
+// Records each worker process can have waiting for the collector
+constexpr std::size_t ring_capacity = 1 << 16;
+
+// Worker processes that haven't been reaped yet. Whichever way the collector
+// leaves, the workers it leaves behind are killed rather than left playing
+// games nobody will read.
+class WorkerProcesses {
+public:
+	explicit WorkerProcesses(std::atomic<bool> & collecting)
+	: m_collecting(collecting) {
+		m_collecting = true;
+	}
+
+	~WorkerProcesses() {
+		m_collecting = false;
+		for (auto pid : m_pids) {
+			kill(pid, SIGKILL);
+			waitpid(pid, nullptr, 0);
+		}
+	}
+
+	WorkerProcesses(const WorkerProcesses &) = delete;
+	WorkerProcesses & operator=(const WorkerProcesses &) = delete;
+
+	void add(pid_t pid) {
+		m_pids.push_back(pid);
+	}
+
+	// Reaps one worker that has exited, if any has. False while all are running
+	bool reap(bool & failed) {
+		int status;
+		auto pid = waitpid(-1, &status, WNOHANG);
+		if (pid <= 0) {
+			return false;
+		}
+		m_pids.erase(std::remove(m_pids.begin(), m_pids.end(), pid), m_pids.end());
+		failed = !WIFEXITED(status) || WEXITSTATUS(status) != 0;
+		return true;
+	}
+
+	std::size_t running() const {
+		return m_pids.size();
+	}
+
+private:
+	std::atomic<bool> & m_collecting;
+	std::vector<pid_t> m_pids;
+};
+
+// Every worker is a forked process with its own heap and cache, playing games
+// until the shared count runs out and pushing each finished game into a ring
+// of its own. The parent only copies records out of the rings into the
+// writer, whose own thread does the file work. A worker that crashes loses
+// the game it was playing and nothing else.
+static PlayResult play_in_processes(const std::function<DatasetWriter &()> & open_writer, unsigned long games,
+	const Heuristic & heuristic, const std::vector<std::uint32_t> & seeds) {
+	struct alignas(64) Counters {
+		std::atomic<unsigned long> next_game;
+		std::atomic<unsigned long> finished_games;
+		// cleared when the collector stops reading, however it stops
+		std::atomic<bool> collecting;
+	};
+	static_assert(std::atomic<unsigned long>::is_always_lock_free);
+	static_assert(std::atomic<bool>::is_always_lock_free);
+
+	auto ring_bytes = (SharedRing<DatasetRecord>::bytes_needed(ring_capacity) + 63) / 64 * 64;
+	SharedMemory memory(sizeof(Counters) + seeds.size() * ring_bytes);
+	auto counters = new (memory.get_data()) Counters{{0}, {0}, {false}};
+
+	std::vector<SharedRing<DatasetRecord>> rings;
+	for (std::size_t i = 0; i < seeds.size(); i++) {
+		rings.emplace_back(memory.get_data() + sizeof(Counters) + i * ring_bytes, ring_capacity);
+	}
+
+	// forked children would print whatever was still buffered again
+	std::cout.flush();
+
+	WorkerProcesses workers(counters->collecting);
+	auto parent = getpid();
+	for (std::size_t i = 0; i < seeds.size(); i++) {
+		auto pid = fork();
+		if (pid < 0) {
+			std::cerr << "Unable to start worker " << i << ", carrying on with " << workers.running() << "\n";
+			break;
+		}
+
+		if (pid == 0) {
+#ifdef __linux__
+			// killed along with the collector, even if it is killed outright
+			prctl(PR_SET_PDEATHSIG, SIGKILL);
+#endif
+			// elsewhere, and in case the collector died before prctl, a worker
+			// being handed to init is how it notices
+			auto collector_alive = [&] {
+				return counters->collecting && getppid() == parent;
+			};
+
+			int status = 0;
+			try {
+				// each process gets its own cache: sharing one across processes would
+				// bring back the contention they are there to avoid
+				TranspositionTable table(64 << 20);
+				Game game(seeds[i]);
+				AI ai(2, &table, &heuristic);
+				std::vector<DatasetRecord> records;
+
+				while (collector_alive() && counters->next_game++ < games) {
+					table.new_search();
+					play_game(game, ai, records);
+					if (!rings[i].push(records.data(), records.size(), collector_alive)) {
+						break;
+					}
+					counters->finished_games++;
+				}
+			} catch (const std::exception & e) {
+				std::cerr << "Worker " << i << ": " << e.what() << "\n";
+				status = 1;
+			}
+			// skips destructors and atexit handlers, which belong to the parent
+			_exit(status);
+		}
+
+		workers.add(pid);
+	}
+
+	auto & writer = open_writer();
+	std::vector<DatasetRecord> buffer(ring_capacity);
+	std::uint64_t total_records = 0;
+	while (true) {
+		bool collected = false;
+		for (auto & ring : rings) {
+			auto count = ring.pop(buffer.data(), buffer.size());
+			for (std::size_t i = 0; i < count; i++) {
+				writer.add(buffer[i]);
+			}
+			total_records += count;
+			collected = collected || count;
+		}
+		if (collected) {
+			continue;
+		}
+
+		// whatever a worker pushed before exiting is picked up by the next pass
+		if (!workers.running()) {
+			break;
+		}
+		bool failed;
+		if (workers.reap(failed)) {
+			if (failed) {
+				std::cerr << "A worker process failed, its current game is lost\n";
+			}
+		} else {
+			std::this_thread::sleep_for(std::chrono::microseconds(100));
+		}
+	}
+
+	return {total_records, counters->finished_games.load()};
+}
+#endif
+
+static int play(std::vector<std::string> arguments) {
+	auto take_flag = [&](const std::string & name) {
+		auto flag = std::find(arguments.begin(), arguments.end(), name);
+		if (flag == arguments.end()) {
+			return false;
+		}
+		arguments.erase(flag);
+		return true;
+	};
+	bool compress = take_flag("--compress");
+	bool processes = take_flag("--processes");
+	if (arguments.size() < 2 || arguments.size() > 3) {
+		usage();
+		return 1;
+	}
+
+	auto games = std::stoul(arguments[0]);
+	auto prefix = arguments[1];
+	auto workers = arguments.size() > 2 ? static_cast<unsigned>(std::stoul(arguments[2])) : std::thread::hardware_concurrency();
+	workers = std::max(workers, 1u);
+
+	std::seed_seq seeds{std::random_device{}(), std::random_device{}()};
+	std::vector<std::uint32_t> worker_seeds(workers);
+	seeds.generate(worker_seeds.begin(), worker_seeds.end());
+
+	// built once up front, so forked workers all read the same pages
+	Heuristic heuristic;
+
+	auto start = std::chrono::steady_clock::now();
+
+	std::optional<DatasetWriter> writer;
+	auto open_writer = [&]() -> DatasetWriter & {
+		return writer.emplace(prefix, Board::size, 1 << 20, compress);
+	};
+
+	PlayResult result;
+	if (processes) {
+#ifdef TFE_HAS_FORK
+		// the writer's thread would not survive forking, so it starts after the workers
+		result = play_in_processes(open_writer, games, heuristic, worker_seeds);
+#else
+		std::cerr << "Worker processes are not available on this platform\n";
+		return 1;
+#endif
+	} else {
+		result = play_in_threads(open_writer(), games, heuristic, worker_seeds);
+	}
+	writer->finish();
+
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	std::cout << "Wrote " << result.records << " positions from " << result.games << " games into "
+		<< writer->get_shard_count() << " shards in " << elapsed.count() << "s\n";
+	return 0;
+}
+
+static int info(const std::vector<std::string> & paths) {
+	std::uint64_t records = 0;
+	double final_scores = 0.;
+	std::array<std::uint64_t, 4> moves{};
+
+	for (const auto & path : paths) {
+		DatasetShard shard(path);
+		records += shard.get_count();
+		for (std::uint64_t i = 0; i < shard.get_count(); i++) {
+			final_scores += shard.get_final_scores()[i];
+			moves[shard.get_moves()[i] & 3]++;
+		}
+	}
+
+	std::cout << "Positions: " << records << "\n";
+	if (records) {
+		std::cout << "Mean final score: " << final_scores / static_cast<double>(records) << "\n";
+		std::cout << "Moves (up, left, down, right): " << moves[0] << ", " << moves[1] << ", " << moves[2] << ", " << moves[3] << "\n";
+	}
+	return 0;
+}
+
+int main(int argc, char ** argv) {
+	try {
+		std::string command = argc > 1 ? argv[1] : "";
+		std::vector<std::string> arguments(argv + std::min(argc, 2), argv + argc);
+		if (command == "play") {
+			return play(arguments);
+		} else if (command == "info" && arguments.size()) {
+			return info(arguments);
+		}
+	} catch (const std::exception & e) {
+		std::cerr << e.what() << "\n";
+		return 1;
+	}
+
+	usage();
+	return 1;
+}
@@ -0,0 +1,70 @@
+// SPDX-FileCopyrightText: 2022 metaquarx <metaquarx@protonmail.com>
+// SPDX-License-Identifier: GPL-3.0-only
+
+#include "Tablebase.hpp"
+
+#include <chrono>
+#include <exception>
+#include <iostream>
+#include <string>
+#include <thread>
+
+static void usage() {
+	std::cerr <<
+		"usage: TFE-tablebase generate <size> <goal tile> <output file> [threads]\n"
+		"       TFE-tablebase query <tablebase file> <board as hex>\n";
+}
+
+static int generate(int argc, char ** argv) {
+	auto size = std::stoul(argv[2]);
+	auto goal_tile = std::stoul(argv[3]);
+	std::string path = argv[4];
+	auto threads = argc > 5 ? static_cast<unsigned>(std::stoul(argv[5])) : std::thread::hardware_concurrency();
+
+	unsigned goal = 0;
+	while ((1ul << goal) < goal_tile) {
+		goal++;
+	}
+	if ((1ul << goal) != goal_tile) {
+		std::cerr << "Goal tile must be a power of two\n";
+		return 1;
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	auto count = Tablebase::generate(path, size, goal, threads);
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+	std::cout << "Solved " << count << " positions in " << elapsed.count() << "s\n";
+	return 0;
+}
+
+static int query(char ** argv) {
+	Tablebase tablebase(argv[2]);
+	auto entry = tablebase.lookup(std::stoull(argv[3], nullptr, 16));
+	if (!entry) {
+		std::cout << "Not in the table\n";
+		return 1;
+	}
+
+	static const char * move_names[] = {"up", "left", "down", "right"};
+	std::cout << "Win probability: " << entry->win_probability << "\n";
+	std::cout << "Best move: " << (entry->best_move ? move_names[static_cast<int>(*entry->best_move)] : "none") << "\n";
+	return 0;
+}
+
+int main(int argc, char ** argv) {
+	try {
+		std::string command = argc > 1 ? argv[1] : "";
+		if (command == "generate" && argc >= 5) {
+			return generate(argc, argv);
+		} else if (command == "query" && argc == 4) {
+			return query(argv);
+		}
+	} catch (const std::exception & e) {
+		std::cerr << e.what() << "\n";
+		return 1;
+	}
+
+	usage();
+	return 1;
+}
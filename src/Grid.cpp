@@ -5,34 +5,64 @@
 
 #include "Sqroundre.hpp"
 
-#include <random>
 #include <cassert>
-
+#include <cmath>
+#include <stdexcept>
+
+// The board always covers the same 586x586 square, the tiles and the gaps
+// between them shrink as N grows (129 and 14 for the 4x4 board)
+template <std::size_t N>
+struct Layout {
+	static constexpr float board_size = 586.f;
+	static constexpr float gap = 56.f / N;
+	static constexpr float tile_size = (board_size - static_cast<float>(N + 1) * gap) / N;
+};
+
+template <std::size_t N>
 static sf::Vector2f calculate_tile_position(Coord coord) {
+	constexpr float gap = Layout<N>::gap;
+	constexpr float tile_size = Layout<N>::tile_size;
 	return {
-		7.f + 14.f + (static_cast<float>(coord.x) * (129.f + 14.f)) + 64.f,
-		207.f + 14.f + (static_cast<float>(coord.y) * (129.f + 14.f)) + 64.f
+		7.f + gap + (static_cast<float>(coord.x) * (tile_size + gap)) + std::floor(tile_size / 2.f),
+		207.f + gap + (static_cast<float>(coord.y) * (tile_size + gap)) + std::floor(tile_size / 2.f)
 	};
 }
 
-Grid::Grid(const sf::Font & font)
+template <std::size_t N>
+BasicGrid<N>::BasicGrid(const sf::Font & font, TranspositionTable * table, std::optional<std::uint64_t> seed)
 : m_font{font}
-, m_state(GameState::Ongoing)
-, m_passed(false) {
-	m_background.create({586, 586}, 6, sf::Color(187, 173, 160));
+, m_game(seed ? BasicGame<N>(*seed) : BasicGame<N>())
+, m_ai(2, table) {
+	Tile::preload(m_font, Layout<N>::tile_size);
+
+	m_background.create({Layout<N>::board_size, Layout<N>::board_size}, 6, sf::Color(187, 173, 160));
 	m_background.setPosition({7, 207});
+
+	for (std::size_t i = 0; i < N; i++) {
+		for (std::size_t j = 0; j < N; j++) {
+			auto & cell = m_cells.emplace_back();
+			cell.create({Layout<N>::tile_size, Layout<N>::tile_size}, 6, sf::Color(205, 193, 180), true);
+			cell.setPosition(calculate_tile_position<N>({i, j}));
+		}
+	}
 }
 
-void Grid::draw(sf::RenderTarget & target, sf::RenderStates states) const {
+void GridSnapshot::draw(sf::RenderTarget & target, sf::RenderStates states) const {
+	target.draw(background, states);
+	for (const auto & cell : cells) {
+		target.draw(cell, states);
+	}
+	for (const auto & tile : tiles) {
+		target.draw(tile, states);
+	}
+}
+
+template <std::size_t N>
+void BasicGrid<N>::draw(sf::RenderTarget & target, sf::RenderStates states) const {
 	target.draw(m_background, states);
 
-	for (std::size_t i = 0; i < 4; i++) {
-		for (std::size_t j = 0; j < 4; j++) {
-			Sqroundre empty;
-			empty.create({129, 129}, 6, sf::Color(205, 193, 180), true);
-			empty.setPosition(calculate_tile_position({i, j}));
-			target.draw(empty);
-		}
+	for (const auto & cell : m_cells) {
+		target.draw(cell, states);
 	}
 
 	for (auto column : m_tiles) {
@@ -44,123 +74,139 @@ void Grid::draw(sf::RenderTarget & target, sf::RenderStates states) const {
 	}
 }
 
-void Grid::update(float dt) {
+template <std::size_t N>
+void BasicGrid<N>::update(float dt) {
 	if (m_move_queue.size()) {
 		process_input();
 	}
 
-	bool lost = true;
 	for (auto & column : m_tiles) {
 		for (auto & tile : column) {
 			if (tile) {
 				tile.value().update(dt * (1.f + static_cast<float>(m_move_queue.size())));
-			} else {
-				lost = false;
-			}
-		}
-	}
-	for (std::size_t x = 0; x < 4; x++) {
-		for (std::size_t y = 0; y < 4; y++) {
-			if (y > 0 && y < 3) {
-				if (m_tiles[x][y] == m_tiles[x][y - 1] || m_tiles[x][y] == m_tiles[x][y + 1]) {
-					lost = false;
-				}
-			}
-
-			if (x > 0 && x < 4) {
-				if (m_tiles[x][y] == m_tiles[x - 1][y] || m_tiles[x][y] == m_tiles[x + 1][y]) {
-					lost = false;
-				}
 			}
 		}
 	}
-
-	if (lost && !m_passed) {
-		m_state = GameState::Lose;
-	}
 }
 
-void Grid::queue_input(Move move) {
+template <std::size_t N>
+void BasicGrid<N>::queue_input(Move move) {
 	m_move_queue.push(move);
 }
 
-unsigned Grid::get_score() const {
-	return m_score;
+template <std::size_t N>
+bool BasicGrid<N>::input_pending() const {
+	return !m_move_queue.empty();
+}
+
+template <std::size_t N>
+unsigned BasicGrid<N>::get_score() const {
+	return m_game.get_score();
 }
 
-void Grid::pass() {
-	m_passed = true;
-	m_state = GameState::Ongoing;
+template <std::size_t N>
+void BasicGrid<N>::pass() {
+	m_game.pass();
 }
 
-void Grid::clear() {
+template <std::size_t N>
+void BasicGrid<N>::clear() {
 	m_tiles.fill({std::nullopt});
 	m_move_queue = {};
-	m_score = 0;
-	m_state = GameState::Ongoing;
-	m_passed = false;
 
-	spawn_new();
-	spawn_new();
+	m_game.clear();
+	auto board = m_game.get_board();
+	for (std::size_t x = 0; x < N; x++) {
+		for (std::size_t y = 0; y < N; y++) {
+			if (board.get(x, y)) {
+				place_tile({x, y}, board.get(x, y), true);
+			}
+		}
+	}
 }
 
-void Grid::spawn_new() {
-	auto empty = get_empty();
-	assert(empty.size());
-
-	static std::random_device rdev;
-	static std::default_random_engine reng(rdev());
-
-	std::uniform_int_distribution<unsigned> value_dist(1u, 2u);
-	auto new_value = value_dist(reng);
+template <std::size_t N>
+bool BasicGrid<N>::undo() {
+	if (!m_game.undo()) {
+		return false;
+	}
+	sync();
+	return true;
+}
 
-	std::uniform_int_distribution<unsigned> location_dist(0u, static_cast<unsigned>(empty.size() - 1));
-	auto new_location = empty[location_dist(reng)];
+template <std::size_t N>
+bool BasicGrid<N>::redo() {
+	if (!m_game.redo()) {
+		return false;
+	}
+	sync();
+	return true;
+}
 
-	auto & tile = m_tiles[new_location.x][new_location.y].emplace(m_font);
-	tile.set_value(new_value);
-	tile.slide(calculate_tile_position(new_location), 0);
-	tile.pop();
-	tile.fin(false);
+template <std::size_t N>
+void BasicGrid<N>::advance(Move move) {
+	m_game.apply(move);
 }
 
-std::vector<Coord> Grid::get_empty() const {
-	std::vector<Coord> empty;
-	empty.reserve(16);
-	for (std::size_t x = 0; x < 4; x++) {
-		for (std::size_t y = 0; y < 4; y++) {
-			if (!m_tiles[x][y]) {
-				empty.push_back({x, y});
+template <std::size_t N>
+void BasicGrid<N>::sync() {
+	m_tiles.fill({std::nullopt});
+	m_move_queue = {};
+
+	auto board = m_game.get_board();
+	for (std::size_t x = 0; x < N; x++) {
+		for (std::size_t y = 0; y < N; y++) {
+			if (board.get(x, y)) {
+				place_tile({x, y}, board.get(x, y), false);
 			}
 		}
 	}
-	return empty;
 }
 
-void Grid::process_input() {
+template <std::size_t N>
+BasicBoard<N> BasicGrid<N>::get_board() const {
+	return m_game.get_board();
+}
+
+template <std::size_t N>
+void BasicGrid<N>::place_tile(Coord coord, unsigned value, bool pop) {
+	auto & tile = m_tiles[coord.x][coord.y].emplace(m_font, Layout<N>::tile_size);
+	tile.set_value(value);
+	tile.slide(calculate_tile_position<N>(coord), 0);
+	if (pop) {
+		tile.pop();
+	}
+	tile.fin(false);
+}
+
+template <std::size_t N>
+void BasicGrid<N>::process_input() {
 	auto move = m_move_queue.front();
 	m_move_queue.pop();
-	unsigned score_bonus = 0;
+
+	if (!m_game.apply(move)) {
+		return;
+	}
 
 	bool positive{move == Move::Up || move == Move::Left};
 	bool inverse{move == Move::Left || move == Move::Right};
 
 	auto shift = [&](const TileMap & input) {
 		TileMap new_tiles{};
-		for (std::size_t i = 0; i < 4; i++) {
-			std::size_t current_empty = positive ? 0 : 3;
-			for (std::size_t j = 0; j < 4; j++) {
+		for (std::size_t i = 0; i < N; i++) {
+			std::size_t current_empty = positive ? 0 : N - 1;
+			for (std::size_t j = 0; j < N; j++) {
 				auto x{inverse ? j : i};
 				auto y{inverse ? i : j};
-				x = positive ? x : 3 - x;
-				y = positive ? y : 3 - y;
+				x = positive ? x : N - 1 - x;
+				y = positive ? y : N - 1 - y;
 
 				auto xm = inverse ? current_empty : x;
 				auto ym = inverse ? y : current_empty;
 
 				if (input[x][y]) {
 					new_tiles[xm][ym] = *input[x][y];
-					new_tiles[xm][ym]->slide(calculate_tile_position({xm, ym}), move_speed);
+					new_tiles[xm][ym]->slide(calculate_tile_position<N>({xm, ym}), move_speed);
 
 					if (positive) {
 						current_empty++;
@@ -176,25 +222,20 @@ void Grid::process_input() {
 
 	auto combine = [&](const TileMap & input) {
 		TileMap new_tiles{input};
-		for (std::size_t i = 0; i < 4; i++) {
-			for (std::size_t j = 0; j < 3; j++) {
+		for (std::size_t i = 0; i < N; i++) {
+			for (std::size_t j = 0; j < N - 1; j++) {
 				auto x{inverse ? j : i};
 				auto y{inverse ? i : j};
-				x = move == Move::Right ? 3 - x : x;
-				y = move == Move::Down ? 3 - y : y;
+				x = move == Move::Right ? N - 1 - x : x;
+				y = move == Move::Down ? N - 1 - y : y;
 
 				auto xm = x + (move == Move::Left) - (move == Move::Right);
 				auto ym = y + (move == Move::Up) - (move == Move::Down);
 
-				if (new_tiles[x][y] && new_tiles[xm][ym] && new_tiles[x][y]->get_value() == new_tiles[xm][ym]->get_value()) {
+				if (new_tiles[x][y] && new_tiles[xm][ym] && new_tiles[x][y]->get_value() == new_tiles[xm][ym]->get_value() &&
+					new_tiles[x][y]->get_value() < max_value) {
 					new_tiles[x][y]->increase_value();
 					new_tiles[xm][ym].reset();
-
-					auto new_score{static_cast<unsigned>(std::pow(2, new_tiles[x][y]->get_value()))};
-					score_bonus += new_score;
-					if (new_score == 2048) {
-						m_state = GameState::Win;
-					}
 				}
 			}
 		}
@@ -202,12 +243,12 @@ void Grid::process_input() {
 		return new_tiles;
 	};
 
-	auto new_tiles{shift(combine(shift(m_tiles)))};
+	// the game has already applied the move, the tiles only replay it for the animations
+	m_tiles = shift(combine(shift(m_tiles)));
 
-	std::swap(m_tiles, new_tiles);
-	if (m_tiles != new_tiles) {
-		spawn_new();
-	}
+	auto spawn = m_game.get_last_spawn();
+	assert(spawn);
+	place_tile({spawn->x, spawn->y}, spawn->value, true);
 
 	for (auto & column : m_tiles) {
 		for (auto & tile : column) {
@@ -216,10 +257,62 @@ void Grid::process_input() {
 			}
 		}
 	}
+}
+
+template <std::size_t N>
+GridBase::GameState BasicGrid<N>::get_state() const {
+	return m_game.get_state();
+}
+
+template <std::size_t N>
+unsigned BasicGrid<N>::legal_moves() const {
+	return m_game.legal_moves();
+}
+
+template <std::size_t N>
+std::optional<Move> BasicGrid<N>::suggest_move() const {
+	return m_ai.choose(m_game.get_board());
+}
 
-	m_score += score_bonus;
+template <std::size_t N>
+void BasicGrid<N>::snapshot(GridSnapshot & snapshot) const {
+	// assigning over existing elements keeps their buffers, so after the
+	// first few frames taking a snapshot doesn't allocate
+	snapshot.background = m_background;
+	snapshot.cells = m_cells;
+
+	std::size_t count = 0;
+	for (const auto & column : m_tiles) {
+		for (const auto & tile : column) {
+			if (!tile) {
+				continue;
+			}
+			if (count < snapshot.tiles.size()) {
+				snapshot.tiles[count] = *tile;
+			} else {
+				snapshot.tiles.push_back(*tile);
+			}
+			count++;
+		}
+	}
+	snapshot.tiles.erase(snapshot.tiles.begin() + static_cast<std::ptrdiff_t>(count), snapshot.tiles.end());
 }
 
-Grid::GameState Grid::get_state() const {
-	return m_state;
+template class BasicGrid<3>;
+template class BasicGrid<4>;
+template class BasicGrid<5>;
+template class BasicGrid<6>;
+template class BasicGrid<7>;
+template class BasicGrid<8>;
+
+std::unique_ptr<GridBase> make_grid(std::size_t size, const sf::Font & font, TranspositionTable * table, std::optional<std::uint64_t> seed) {
+	switch (size) {
+		case 3: return std::make_unique<BasicGrid<3>>(font, table, seed);
+		case 4: return std::make_unique<BasicGrid<4>>(font, table, seed);
+		case 5: return std::make_unique<BasicGrid<5>>(font, table, seed);
+		case 6: return std::make_unique<BasicGrid<6>>(font, table, seed);
+		case 7: return std::make_unique<BasicGrid<7>>(font, table, seed);
+		case 8: return std::make_unique<BasicGrid<8>>(font, table, seed);
+		default: throw std::invalid_argument("Board size must be between 3 and 8");
+	}
 }
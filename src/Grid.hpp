@@ -5,47 +5,105 @@
 
 #include <SFML/Graphics.hpp>
 
+#include "AI.hpp"
+#include "Game.hpp"
 #include "Sqroundre.hpp"
 #include "Tile.hpp"
 
 #include <array>
+#include <cstdint>
+#include <memory>
 #include <optional>
 #include <queue>
+#include <vector>
 
-enum class Move {
-	Up, Left, Down, Right
+using Coord = sf::Vector2<std::size_t>;
+
+// A copy of everything a grid draws, so it can be drawn on another thread
+// while the grid itself carries on
+struct GridSnapshot : public sf::Drawable {
+	Sqroundre background;
+	std::vector<Sqroundre> cells;
+	std::vector<Tile> tiles;
+
+	virtual void draw(sf::RenderTarget & target, sf::RenderStates states) const override;
 };
 
-using Coord = sf::Vector2<std::size_t>;
-class Grid : public sf::Drawable {
+// What the window needs from a grid, whatever its size
+class GridBase : public sf::Drawable {
 public:
-	Grid(const sf::Font & font);
+	using GameState = ::GameState;
 
-	virtual void draw(sf::RenderTarget & target, sf::RenderStates states) const override;
+	virtual ~GridBase() = default;
+
+	virtual void update(float dt) = 0;
+	virtual void queue_input(Move move) = 0;
+	virtual bool input_pending() const = 0;
+	virtual unsigned get_score() const = 0;
+	virtual GameState get_state() const = 0;
+	virtual unsigned legal_moves() const = 0;
+	virtual void pass() = 0;
+
+	virtual void clear() = 0;
+	// Steps back or forward through the game's history, snapping the tiles
+	// into place without any animation
+	virtual bool undo() = 0;
+	virtual bool redo() = 0;
 
-	void update(float dt);
-	void queue_input(Move move);
-	unsigned get_score() const;
-	enum class GameState {Ongoing, Win, Lose};
-	GameState get_state() const;
-	void pass();
+	// Applies a move to the game without animating it, call sync() once done
+	virtual void advance(Move move) = 0;
+	virtual void sync() = 0;
+	// The AI's pick for the current board, if there is any move left
+	virtual std::optional<Move> suggest_move() const = 0;
 
-	void clear();
+	// Copies the grid as it would be drawn now, reusing the snapshot's memory
+	virtual void snapshot(GridSnapshot & snapshot) const = 0;
+};
+
+template <std::size_t N>
+class BasicGrid : public GridBase {
+public:
+	// Without a seed every game is different
+	BasicGrid(const sf::Font & font, TranspositionTable * table = nullptr, std::optional<std::uint64_t> seed = std::nullopt);
+
+	virtual void draw(sf::RenderTarget & target, sf::RenderStates states) const override;
+
+	virtual void update(float dt) override;
+	virtual void queue_input(Move move) override;
+	virtual bool input_pending() const override;
+	virtual unsigned get_score() const override;
+	virtual GameState get_state() const override;
+	virtual unsigned legal_moves() const override;
+	virtual void pass() override;
 
+	virtual void clear() override;
+	virtual bool undo() override;
+	virtual bool redo() override;
 
+	virtual void advance(Move move) override;
+	virtual void sync() override;
+	virtual std::optional<Move> suggest_move() const override;
+	virtual void snapshot(GridSnapshot & snapshot) const override;
+	BasicBoard<N> get_board() const;
 
 private:
 	Sqroundre m_background;
+	// the empty cells behind the tiles
+	std::vector<Sqroundre> m_cells;
 	const sf::Font & m_font;
 
-	using TileMap = std::array<std::array<std::optional<Tile>, 4>, 4>;
+	using TileMap = std::array<std::array<std::optional<Tile>, N>, N>;
 	TileMap m_tiles;
 	std::queue<Move> m_move_queue;
-	unsigned m_score;
-	GameState m_state;
-	bool m_passed;
+	BasicGame<N> m_game;
+	BasicAI<N> m_ai;
 
-	std::vector<Coord> get_empty() const;
-	void spawn_new();
+	void place_tile(Coord coord, unsigned value, bool pop);
 	void process_input();
 };
+
+using Grid = BasicGrid<4>;
+
+// Makes a grid of any size between min_board_size and max_board_size
+std::unique_ptr<GridBase> make_grid(std::size_t size, const sf::Font & font, TranspositionTable * table = nullptr,
+	std::optional<std::uint64_t> seed = std::nullopt);
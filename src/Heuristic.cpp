@@ -0,0 +1,209 @@
+// SPDX-FileCopyrightText: 2022 metaquarx <metaquarx@protonmail.com>
+// SPDX-License-Identifier: GPL-3.0-only
+
+#include "Heuristic.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+
+struct LineFeatures {
+	float empty;
+	float monotonicity;
+	float smoothness;
+	float merges;
+	float corner;
+};
+
+template <std::size_t N>
+LineFeatures line_features(const std::array<unsigned, N> & cells) {
+	LineFeatures features{0.f, 0.f, 0.f, 0.f, 0.f};
+
+	// monotonicity counts big tiles far more than small ones
+	float rising = 0.f;
+	float falling = 0.f;
+	for (std::size_t i = 1; i < N; i++) {
+		auto before = std::pow(static_cast<float>(cells[i - 1]), 4.f);
+		auto after = std::pow(static_cast<float>(cells[i]), 4.f);
+		if (before > after) {
+			falling += before - after;
+		} else {
+			rising += after - before;
+		}
+	}
+	features.monotonicity = -std::min(rising, falling);
+
+	// smoothness and merges compare tiles that would end up next to each other, skipping gaps
+	unsigned previous = 0;
+	for (auto cell : cells) {
+		if (!cell) {
+			features.empty++;
+			continue;
+		}
+		if (previous) {
+			features.smoothness -= static_cast<float>(std::max(cell, previous) - std::min(cell, previous));
+			features.merges += cell == previous;
+		}
+		previous = cell;
+	}
+
+	auto biggest = std::max_element(cells.begin(), cells.end());
+	if (*biggest && (*biggest == cells.front() || *biggest == cells.back())) {
+		features.corner = static_cast<float>(*biggest);
+	}
+
+	return features;
+}
+
+float weighted(const LineFeatures & features, const HeuristicWeights & weights) {
+	return weights.alive +
+		weights.empty * features.empty +
+		weights.monotonicity * features.monotonicity +
+		weights.smoothness * features.smoothness +
+		weights.merges * features.merges +
+		weights.corner * features.corner;
+}
+
+// Features of every possible row of a packed board, shared by every heuristic
+template <std::size_t N>
+const std::vector<LineFeatures> & line_table() {
+	static const std::vector<LineFeatures> table = [] {
+		std::vector<LineFeatures> lines(std::size_t{1} << (4 * N));
+		for (std::size_t row = 0; row < lines.size(); row++) {
+			std::array<unsigned, N> cells;
+			for (std::size_t i = 0; i < N; i++) {
+				cells[i] = static_cast<unsigned>((row >> (4 * i)) & 0xF);
+			}
+			lines[row] = line_features<N>(cells);
+		}
+		return lines;
+	}();
+	return table;
+}
+
+}
+
+void HeuristicWeights::parse(const std::string & text) {
+	std::istringstream stream(text);
+	std::string item;
+	while (std::getline(stream, item, ',')) {
+		auto equals = item.find('=');
+		if (equals == std::string::npos) {
+			throw std::invalid_argument("Expected name=value, got " + item);
+		}
+
+		auto name = item.substr(0, equals);
+		auto value = std::stof(item.substr(equals + 1));
+		if (name == "alive") {
+			alive = value;
+		} else if (name == "empty") {
+			empty = value;
+		} else if (name == "monotonicity") {
+			monotonicity = value;
+		} else if (name == "smoothness") {
+			smoothness = value;
+		} else if (name == "merges") {
+			merges = value;
+		} else if (name == "corner") {
+			corner = value;
+		} else {
+			throw std::invalid_argument("Unknown heuristic weight " + name);
+		}
+	}
+}
+
+std::uint64_t table_tag(std::size_t board_size, const HeuristicWeights & weights) {
+	std::uint64_t tag = board_size;
+	for (auto weight : {weights.alive, weights.empty, weights.monotonicity, weights.smoothness, weights.merges, weights.corner}) {
+		std::uint32_t bits;
+		std::memcpy(&bits, &weight, sizeof(bits));
+		tag = hash_cells(tag ^ bits);
+	}
+	return tag;
+}
+
+template <std::size_t N>
+BasicHeuristic<N>::BasicHeuristic(const HeuristicWeights & weights) {
+	set_weights(weights);
+}
+
+template <std::size_t N>
+float BasicHeuristic<N>::evaluate(Board board) const {
+	float score = 0.f;
+
+	if constexpr (Board::packed) {
+		constexpr std::uint64_t row_mask = (1u << (4 * N)) - 1;
+		auto rows = board.raw();
+		auto columns = board.transpose().raw();
+		for (std::size_t i = 0; i < N; i++) {
+			score += m_lines[(rows >> (4 * N * i)) & row_mask];
+			score += m_lines[(columns >> (4 * N * i)) & row_mask];
+		}
+	} else {
+		std::array<unsigned, N> row;
+		std::array<unsigned, N> column;
+		for (std::size_t i = 0; i < N; i++) {
+			for (std::size_t j = 0; j < N; j++) {
+				row[j] = board.get(j, i);
+				column[j] = board.get(i, j);
+			}
+			score += weighted(line_features<N>(row), m_weights);
+			score += weighted(line_features<N>(column), m_weights);
+		}
+	}
+
+	return score;
+}
+
+template <std::size_t N>
+float BasicHeuristic<N>::lost_score() const {
+	return m_lost_score;
+}
+
+template <std::size_t N>
+void BasicHeuristic<N>::set_weights(const HeuristicWeights & weights) {
+	m_weights = weights;
+
+	// the lowest a line can score takes each feature at whichever end of its
+	// range costs the most, for any tiles up to max_value
+	constexpr auto cells = static_cast<float>(N);
+	constexpr auto steps = static_cast<float>(N - 1);
+	constexpr auto top = static_cast<float>(max_value);
+	auto lowest = [](float weight, float low, float high) {
+		return std::min(weight * low, weight * high);
+	};
+	float line = m_weights.alive +
+		lowest(m_weights.empty, 0.f, cells) +
+		lowest(m_weights.monotonicity, -steps * top * top * top * top, 0.f) +
+		lowest(m_weights.smoothness, -steps * top, 0.f) +
+		lowest(m_weights.merges, 0.f, steps) +
+		lowest(m_weights.corner, 0.f, top);
+	// with room for the rounding of adding up 2N lines
+	float board = 2.f * cells * line;
+	m_lost_score = board - std::abs(board) * 1e-4f - 1.f;
+
+	if constexpr (Board::packed) {
+		const auto & lines = line_table<N>();
+		m_lines.resize(lines.size());
+		for (std::size_t i = 0; i < lines.size(); i++) {
+			m_lines[i] = weighted(lines[i], m_weights);
+		}
+	}
+}
+
+template <std::size_t N>
+const HeuristicWeights & BasicHeuristic<N>::get_weights() const {
+	return m_weights;
+}
+
+template class BasicHeuristic<3>;
+template class BasicHeuristic<4>;
+template class BasicHeuristic<5>;
+template class BasicHeuristic<6>;
+template class BasicHeuristic<7>;
+template class BasicHeuristic<8>;
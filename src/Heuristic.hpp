@@ -0,0 +1,75 @@
+// SPDX-FileCopyrightText: 2022 metaquarx <metaquarx@protonmail.com>
+// SPDX-License-Identifier: GPL-3.0-only
+
+#pragma once
+
+#include "Board.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// How much each feature of a row or column counts for. Every feature is
+// measured on the tile exponents of one line at a time:
+struct HeuristicWeights {
+	// added for every line, for staying alive
+	float alive = 200000.f;
+	// per empty cell
+	float empty = 270.f;
+	// penalty for tiles going up and down along the line, rather than
+	// steadily one way, with big tiles counting for far more than small ones
+	float monotonicity = 47.f;
+	// penalty per step of difference between neighbouring tiles
+	float smoothness = 100.f;
+	// per pair of equal tiles that would merge if the line slid
+	float merges = 700.f;
+	// per exponent of the biggest tile in the line, when it sits at one end
+	float corner = 200.f;
+
+	// Reads weights written as "empty=270,merges=700", any left out keep
+	// their current value
+	void parse(const std::string & text);
+};
+
+// Tag for saved transposition tables: cached values are only good for the
+// board size and weights they were scored with
+std::uint64_t table_tag(std::size_t board_size, const HeuristicWeights & weights);
+
+// Scores boards for the search by adding up features of every row and column.
+// Every feature is bounded, and so is the score: lost_score() is below
+// anything a board that is still alive can get, for the search to give lost
+// boards.
+//
+// For packed boards every possible line is scored once up front, so a board
+// takes one lookup per row and column: eight for a 4x4 board. Bigger boards
+// are scored line by line as they come.
+// Changing the weights rebuilds the table, and must not happen during a search.
+template <std::size_t N>
+class BasicHeuristic {
+public:
+	using Board = BasicBoard<N>;
+
+	explicit BasicHeuristic(const HeuristicWeights & weights = {});
+
+	float evaluate(Board board) const;
+	float lost_score() const;
+
+	void set_weights(const HeuristicWeights & weights);
+	const HeuristicWeights & get_weights() const;
+
+private:
+	HeuristicWeights m_weights;
+	// weighted score of every possible line, for packed boards
+	std::vector<float> m_lines;
+	float m_lost_score;
+};
+
+using Heuristic = BasicHeuristic<4>;
+
+extern template class BasicHeuristic<3>;
+extern template class BasicHeuristic<4>;
+extern template class BasicHeuristic<5>;
+extern template class BasicHeuristic<6>;
+extern template class BasicHeuristic<7>;
+extern template class BasicHeuristic<8>;
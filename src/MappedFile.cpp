@@ -0,0 +1,111 @@
+// SPDX-FileCopyrightText: 2022 metaquarx <metaquarx@protonmail.com>
+// SPDX-License-Identifier: GPL-3.0-only
+
+#include "MappedFile.hpp"
+
+#include <stdexcept>
+#include <utility>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile(const std::string & path)
+: m_data(nullptr)
+, m_size(0) {
+#ifdef _WIN32
+	auto file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE) {
+		throw std::runtime_error("Unable to open " + path);
+	}
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+		CloseHandle(file);
+		throw std::runtime_error("Unable to map " + path);
+	}
+
+	auto mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	CloseHandle(file);
+	if (!mapping) {
+		throw std::runtime_error("Unable to map " + path);
+	}
+
+	auto view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	CloseHandle(mapping);
+	if (!view) {
+		throw std::runtime_error("Unable to map " + path);
+	}
+
+	m_data = static_cast<const std::byte *>(view);
+	m_size = static_cast<std::size_t>(size.QuadPart);
+#else
+	int file = open(path.c_str(), O_RDONLY);
+	if (file < 0) {
+		throw std::runtime_error("Unable to open " + path);
+	}
+
+	struct stat info;
+	if (fstat(file, &info) != 0 || info.st_size == 0) {
+		close(file);
+		throw std::runtime_error("Unable to map " + path);
+	}
+
+	auto size = static_cast<std::size_t>(info.st_size);
+	void * view = mmap(nullptr, size, PROT_READ, MAP_SHARED, file, 0);
+	close(file);
+	if (view == MAP_FAILED) {
+		throw std::runtime_error("Unable to map " + path);
+	}
+
+	m_data = static_cast<const std::byte *>(view);
+	m_size = size;
+#endif
+}
+
+MappedFile::~MappedFile() {
+	unmap();
+}
+
+MappedFile::MappedFile(MappedFile && other) noexcept
+: m_data(std::exchange(other.m_data, nullptr))
+, m_size(std::exchange(other.m_size, 0)) {
+}
+
+MappedFile & MappedFile::operator=(MappedFile && other) noexcept {
+	if (this != &other) {
+		unmap();
+		m_data = std::exchange(other.m_data, nullptr);
+		m_size = std::exchange(other.m_size, 0);
+	}
+	return *this;
+}
+
+const std::byte * MappedFile::get_data() const {
+	return m_data;
+}
+
+std::size_t MappedFile::get_size() const {
+	return m_size;
+}
+
+void MappedFile::unmap() {
+	if (!m_data) {
+		return;
+	}
+
+#ifdef _WIN32
+	UnmapViewOfFile(m_data);
+#else
+	munmap(const_cast<std::byte *>(m_data), m_size);
+#endif
+	m_data = nullptr;
+	m_size = 0;
+}
@@ -0,0 +1,28 @@
+// SPDX-FileCopyrightText: 2022 metaquarx <metaquarx@protonmail.com>
+// SPDX-License-Identifier: GPL-3.0-only
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+// Read-only view of a whole file, mapped into memory
+class MappedFile {
+public:
+	explicit MappedFile(const std::string & path);
+	~MappedFile();
+
+	MappedFile(const MappedFile &) = delete;
+	MappedFile & operator=(const MappedFile &) = delete;
+	MappedFile(MappedFile && other) noexcept;
+	MappedFile & operator=(MappedFile && other) noexcept;
+
+	const std::byte * get_data() const;
+	std::size_t get_size() const;
+
+private:
+	const std::byte * m_data;
+	std::size_t m_size;
+
+	void unmap();
+};
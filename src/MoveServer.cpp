@@ -0,0 +1,330 @@
+// SPDX-FileCopyrightText: 2022 metaquarx <metaquarx@protonmail.com>
+// SPDX-License-Identifier: GPL-3.0-only
+
+#include "MoveServer.hpp"
+
+#include "AI.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <numeric>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+namespace {
+
+sockaddr_un socket_address(const std::string & path) {
+	sockaddr_un address{};
+	address.sun_family = AF_UNIX;
+	if (path.size() >= sizeof(address.sun_path)) {
+		throw std::invalid_argument("Socket path too long: " + path);
+	}
+	std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+	return address;
+}
+
+bool send_all(int fd, const void * data, std::size_t size) {
+	auto bytes = static_cast<const char *>(data);
+	while (size) {
+		auto sent = send(fd, bytes, size, MSG_NOSIGNAL);
+		if (sent < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			return false;
+		}
+		bytes += sent;
+		size -= static_cast<std::size_t>(sent);
+	}
+	return true;
+}
+
+bool receive_all(int fd, void * data, std::size_t size) {
+	auto bytes = static_cast<char *>(data);
+	while (size) {
+		auto received = recv(fd, bytes, size, 0);
+		if (received <= 0) {
+			if (received < 0 && errno == EINTR) {
+				continue;
+			}
+			return false;
+		}
+		bytes += received;
+		size -= static_cast<std::size_t>(received);
+	}
+	return true;
+}
+
+}
+
+MoveServer::MoveServer(std::string socket_path, const Settings & settings)
+: m_socket_path(std::move(socket_path))
+, m_settings(settings)
+, m_listener(-1)
+, m_tables{TranspositionTable((settings.cache_megabytes << 20) / 8), TranspositionTable(settings.cache_megabytes << 20)}
+, m_small_heuristic(settings.weights)
+, m_heuristic(settings.weights)
+, m_pool(std::max(settings.threads, 1u)) {
+	if (m_settings.cache_file) {
+		m_tables[1].load(*m_settings.cache_file, table_tag(4, m_settings.weights));
+	}
+
+	auto address = socket_address(m_socket_path);
+	m_listener = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (m_listener < 0) {
+		throw std::runtime_error("Unable to create socket " + m_socket_path);
+	}
+
+	if (bind(m_listener, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) != 0) {
+		// a socket file left behind by a server that is no longer running can be replaced
+		bool stale = false;
+		if (errno == EADDRINUSE) {
+			int probe = socket(AF_UNIX, SOCK_STREAM, 0);
+			stale = probe >= 0 && connect(probe, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) != 0;
+			if (probe >= 0) {
+				close(probe);
+			}
+		}
+
+		if (!stale || unlink(m_socket_path.c_str()) != 0 ||
+			bind(m_listener, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) != 0) {
+			close(m_listener);
+			throw std::runtime_error("Unable to listen on " + m_socket_path + ", is another server running?");
+		}
+	}
+
+	if (listen(m_listener, 64) != 0) {
+		close(m_listener);
+		unlink(m_socket_path.c_str());
+		throw std::runtime_error("Unable to listen on " + m_socket_path);
+	}
+}
+
+MoveServer::~MoveServer() {
+	for (auto & client : m_clients) {
+		close(client.fd);
+	}
+	close(m_listener);
+	unlink(m_socket_path.c_str());
+
+	if (m_settings.cache_file) {
+		m_tables[1].save(*m_settings.cache_file, table_tag(4, m_settings.weights));
+	}
+}
+
+void MoveServer::run(const std::atomic<bool> & stop) {
+	std::vector<pollfd> fds;
+	std::vector<Job> jobs;
+
+	while (!stop) {
+		fds.clear();
+		fds.push_back({m_listener, POLLIN, 0});
+		for (const auto & client : m_clients) {
+			fds.push_back({client.fd, POLLIN, 0});
+		}
+
+		// wakes up now and then to notice stop
+		if (poll(fds.data(), static_cast<nfds_t>(fds.size()), 100) < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			throw std::runtime_error("Unable to wait for requests");
+		}
+
+		// everything that arrived while the last batch was searched forms the next one
+		jobs.clear();
+		for (std::size_t i = 0; i < m_clients.size(); i++) {
+			if (fds[i + 1].revents) {
+				m_clients[i].open = read_requests(i, jobs);
+			}
+		}
+
+		if (!jobs.empty()) {
+			answer(jobs);
+		}
+
+		auto closed = std::remove_if(m_clients.begin(), m_clients.end(), [](const Client & client) {
+			if (!client.open) {
+				close(client.fd);
+			}
+			return !client.open;
+		});
+		m_clients.erase(closed, m_clients.end());
+
+		if (fds[0].revents & POLLIN) {
+			accept_clients();
+		}
+	}
+}
+
+void MoveServer::accept_clients() {
+	int fd = accept(m_listener, nullptr, nullptr);
+	if (fd >= 0) {
+		m_clients.push_back({fd, {}, {}, true});
+	}
+}
+
+bool MoveServer::read_requests(std::size_t client, std::vector<Job> & jobs) {
+	auto & input = m_clients[client].input;
+	bool open = true;
+
+	std::array<std::byte, 4096> buffer;
+	while (true) {
+		auto received = recv(m_clients[client].fd, buffer.data(), buffer.size(), MSG_DONTWAIT);
+		if (received > 0) {
+			input.insert(input.end(), buffer.begin(), buffer.begin() + received);
+			continue;
+		}
+		if (received < 0 && errno == EINTR) {
+			continue;
+		}
+		open = received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
+		break;
+	}
+
+	// requests that arrived in full are answered even if the client has since hung up
+	auto count = input.size() / sizeof(MoveRequest);
+	for (std::size_t i = 0; i < count; i++) {
+		Job job{{}, client, 0};
+		std::memcpy(&job.request, input.data() + i * sizeof(MoveRequest), sizeof(MoveRequest));
+		jobs.push_back(job);
+	}
+	input.erase(input.begin(), input.begin() + static_cast<std::ptrdiff_t>(count * sizeof(MoveRequest)));
+
+	return open;
+}
+
+void MoveServer::answer(std::vector<Job> & jobs) {
+	// identical requests are searched once
+	auto key = [&](std::size_t i) {
+		const auto & request = jobs[i].request;
+		return std::make_tuple(request.board, request.size, request.depth, request.depth ? 0 : request.budget);
+	};
+
+	std::vector<std::size_t> order(jobs.size());
+	std::iota(order.begin(), order.end(), 0);
+	std::sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b) {
+		return key(a) < key(b);
+	});
+
+	std::vector<MoveRequest> unique;
+	for (std::size_t i = 0; i < order.size(); i++) {
+		if (i == 0 || key(order[i]) != key(order[i - 1])) {
+			unique.push_back(jobs[order[i]].request);
+		}
+		jobs[order[i]].result = unique.size() - 1;
+	}
+
+	// results from earlier batches are the first to go
+	for (auto & table : m_tables) {
+		table.new_search();
+	}
+
+	// a single request is searched right here, without waking the pool
+	std::vector<MoveResponse> results(unique.size());
+	m_pool.run(unique.size(), [&](std::size_t i) {
+		results[i] = search(unique[i]);
+	});
+
+	for (const auto & job : jobs) {
+		auto response = results[job.result];
+		response.id = job.request.id;
+		m_clients[job.client].output.push_back(response);
+	}
+
+	// one write per client per batch. A client that stops reading stalls the
+	// server, which is fine for the local tools this is meant for
+	for (auto & client : m_clients) {
+		if (!client.output.empty()) {
+			if (!send_all(client.fd, client.output.data(), client.output.size() * sizeof(MoveResponse))) {
+				client.open = false;
+			}
+			client.output.clear();
+		}
+	}
+}
+
+MoveResponse MoveServer::search(const MoveRequest & request) {
+	MoveResponse response{request.id, no_move_found, static_cast<std::uint8_t>(MoveStatus::Ok), 0};
+
+	bool timed = request.depth == 0;
+	bool valid = (timed ? request.budget <= m_settings.max_budget : request.depth <= m_settings.max_depth) &&
+		(request.size == 4 || (request.size == 3 && request.board >> 36 == 0));
+	if (!valid) {
+		response.status = static_cast<std::uint8_t>(MoveStatus::BadRequest);
+		return response;
+	}
+
+	std::chrono::microseconds budget(request.budget);
+	std::optional<Move> move;
+	if (request.size == 3) {
+		BasicAI<3> ai(std::max<unsigned>(request.depth, 1), &m_tables[0], &m_small_heuristic);
+		move = timed ? ai.choose(BasicBoard<3>(request.board), budget) : ai.choose(BasicBoard<3>(request.board));
+	} else {
+		AI ai(std::max<unsigned>(request.depth, 1), &m_tables[1], &m_heuristic);
+		move = timed ? ai.choose(Board(request.board), budget) : ai.choose(Board(request.board));
+	}
+
+	if (move) {
+		response.move = static_cast<std::uint8_t>(*move);
+	}
+	return response;
+}
+
+MoveClient::MoveClient(const std::string & socket_path)
+: m_fd(-1)
+, m_next_id(0) {
+	auto address = socket_address(socket_path);
+	m_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (m_fd < 0 || connect(m_fd, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) != 0) {
+		if (m_fd >= 0) {
+			close(m_fd);
+		}
+		throw std::runtime_error("Unable to connect to " + socket_path);
+	}
+}
+
+MoveClient::~MoveClient() {
+	close(m_fd);
+}
+
+std::optional<Move> MoveClient::best_move(std::uint64_t board, std::size_t size, unsigned depth) {
+	if (depth == 0) {
+		throw std::invalid_argument("Search depth must be at least 1");
+	}
+	return send_request({board, 0, static_cast<std::uint8_t>(size), static_cast<std::uint8_t>(depth), 0});
+}
+
+std::optional<Move> MoveClient::best_move_within(std::uint64_t board, std::chrono::microseconds budget, std::size_t size) {
+	if (budget.count() < 0 || budget.count() > 0xFFFF) {
+		throw std::invalid_argument("Search budget must be under 65536us");
+	}
+	return send_request({board, 0, static_cast<std::uint8_t>(size), 0, static_cast<std::uint16_t>(budget.count())});
+}
+
+std::optional<Move> MoveClient::send_request(MoveRequest request) {
+	request.id = m_next_id++;
+	MoveResponse response;
+	if (!send_all(m_fd, &request, sizeof(request)) || !receive_all(m_fd, &response, sizeof(response))) {
+		throw std::runtime_error("Lost connection to the move server");
+	}
+
+	if (response.status != static_cast<std::uint8_t>(MoveStatus::Ok) || response.id != request.id) {
+		throw std::runtime_error("Move server rejected the request");
+	}
+	if (response.move >= all_moves.size()) {
+		return std::nullopt;
+	}
+	return all_moves[response.move];
+}
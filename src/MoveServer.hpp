@@ -0,0 +1,124 @@
+// SPDX-FileCopyrightText: 2022 metaquarx <metaquarx@protonmail.com>
+// SPDX-License-Identifier: GPL-3.0-only
+
+#pragma once
+
+#include "Board.hpp"
+#include "Heuristic.hpp"
+#include "TranspositionTable.hpp"
+#include "WorkerPool.hpp"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Wire format, in native byte order since both ends are on the same machine.
+// A client may send any number of requests before reading the responses,
+// which come back in the order the requests were sent.
+struct MoveRequest {
+	// packed board, 3x3 or 4x4
+	std::uint64_t board;
+	// echoed back in the response
+	std::uint32_t id;
+	std::uint8_t size;
+	// 0 to search for budget microseconds instead of to a fixed depth
+	std::uint8_t depth;
+	std::uint16_t budget;
+};
+static_assert(sizeof(MoveRequest) == 16);
+
+struct MoveResponse {
+	std::uint32_t id;
+	// index into all_moves, or no_move_found
+	std::uint8_t move;
+	std::uint8_t status;
+	std::uint16_t reserved;
+};
+static_assert(sizeof(MoveResponse) == 8);
+
+constexpr std::uint8_t no_move_found = 4;
+
+enum class MoveStatus : std::uint8_t {Ok, BadRequest};
+
+// Long running process answering best move requests over a Unix domain
+// socket, so the transposition tables stay warm between queries.
+//
+// Every request that arrived since the last round is answered as one batch:
+// identical requests are searched once, and the rest are spread over a pool
+// of threads that all share the same tables.
+class MoveServer {
+public:
+	struct Settings {
+		std::size_t cache_megabytes = 256;
+		unsigned threads = std::thread::hardware_concurrency();
+		unsigned max_depth = 6;
+		// longest a timed search may take, in microseconds
+		unsigned max_budget = 50000;
+		std::optional<std::string> cache_file;
+		HeuristicWeights weights;
+	};
+
+	MoveServer(std::string socket_path, const Settings & settings);
+	~MoveServer();
+
+	MoveServer(const MoveServer &) = delete;
+	MoveServer & operator=(const MoveServer &) = delete;
+
+	// Serves requests until stop is set
+	void run(const std::atomic<bool> & stop);
+
+private:
+	struct Client {
+		int fd;
+		std::vector<std::byte> input;
+		std::vector<MoveResponse> output;
+		bool open;
+	};
+
+	struct Job {
+		MoveRequest request;
+		std::size_t client;
+		std::size_t result;
+	};
+
+	std::string m_socket_path;
+	Settings m_settings;
+	int m_listener;
+	std::vector<Client> m_clients;
+	// 3x3 and 4x4 boards can share packed values, so each size gets its own table
+	std::array<TranspositionTable, 2> m_tables;
+	BasicHeuristic<3> m_small_heuristic;
+	Heuristic m_heuristic;
+	WorkerPool m_pool;
+
+	void accept_clients();
+	bool read_requests(std::size_t client, std::vector<Job> & jobs);
+	void answer(std::vector<Job> & jobs);
+	MoveResponse search(const MoveRequest & request);
+};
+
+// Blocking connection to a MoveServer
+class MoveClient {
+public:
+	explicit MoveClient(const std::string & socket_path);
+	~MoveClient();
+
+	MoveClient(const MoveClient &) = delete;
+	MoveClient & operator=(const MoveClient &) = delete;
+
+	std::optional<Move> best_move(std::uint64_t board, std::size_t size = 4, unsigned depth = 2);
+	// Best move the server finds within budget, not counting the round trip
+	std::optional<Move> best_move_within(std::uint64_t board, std::chrono::microseconds budget, std::size_t size = 4);
+
+private:
+	int m_fd;
+	std::uint32_t m_next_id;
+
+	std::optional<Move> send_request(MoveRequest request);
+};
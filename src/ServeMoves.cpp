@@ -0,0 +1,156 @@
+// SPDX-FileCopyrightText: 2022 metaquarx <metaquarx@protonmail.com>
+// SPDX-License-Identifier: GPL-3.0-only
+
+#include "Game.hpp"
+#include "MoveServer.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <exception>
+#include <iostream>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+static std::atomic<bool> stop_requested{false};
+
+extern "C" void request_stop(int) {
+	stop_requested = true;
+}
+
+static void usage() {
+	std::cerr <<
+		"usage: TFE-server serve <socket> [--cache <file>] [--cache-size <megabytes>] [--threads <count>] [--max-depth <depth>]\n"
+		"                    [--max-budget <microseconds>] [--weights <name=value,...>]\n"
+		"       TFE-server query <socket> <board as hex> [size] [depth | <budget>us]\n"
+		"       TFE-server bench <socket> <requests> [depth | <budget>us]\n";
+}
+
+// A search limit is either a depth, or a time budget like 2000us
+struct SearchLimit {
+	unsigned depth;
+	std::chrono::microseconds budget;
+};
+
+static SearchLimit parse_limit(const std::string & argument) {
+	std::size_t end;
+	auto value = std::stoul(argument, &end);
+	if (argument.substr(end) == "us") {
+		return {0, std::chrono::microseconds(value)};
+	} else if (end != argument.size()) {
+		throw std::invalid_argument("Expected a depth or a budget like 2000us, got " + argument);
+	} else if (value == 0) {
+		// depth 0 is how requests mark a time budget
+		throw std::invalid_argument("Search depth must be at least 1");
+	}
+	return {static_cast<unsigned>(value), {}};
+}
+
+static std::optional<Move> best_move(MoveClient & client, std::uint64_t board, std::size_t size, SearchLimit limit) {
+	return limit.depth ? client.best_move(board, size, limit.depth) : client.best_move_within(board, limit.budget, size);
+}
+
+static int serve(int argc, char ** argv) {
+	MoveServer::Settings settings;
+	for (int i = 3; i < argc; i++) {
+		std::string argument = argv[i];
+		if (argument == "--cache" && i + 1 < argc) {
+			settings.cache_file = argv[++i];
+		} else if (argument == "--cache-size" && i + 1 < argc) {
+			settings.cache_megabytes = std::stoul(argv[++i]);
+		} else if (argument == "--threads" && i + 1 < argc) {
+			settings.threads = static_cast<unsigned>(std::stoul(argv[++i]));
+		} else if (argument == "--max-depth" && i + 1 < argc) {
+			settings.max_depth = static_cast<unsigned>(std::stoul(argv[++i]));
+		} else if (argument == "--max-budget" && i + 1 < argc) {
+			settings.max_budget = static_cast<unsigned>(std::stoul(argv[++i]));
+		} else if (argument == "--weights" && i + 1 < argc) {
+			settings.weights.parse(argv[++i]);
+		} else {
+			usage();
+			return 1;
+		}
+	}
+
+	std::signal(SIGINT, request_stop);
+	std::signal(SIGTERM, request_stop);
+	std::signal(SIGPIPE, SIG_IGN);
+
+	MoveServer server(argv[2], settings);
+	std::cout << "Listening on " << argv[2] << std::endl;
+	server.run(stop_requested);
+	return 0;
+}
+
+static int query(int argc, char ** argv) {
+	MoveClient client(argv[2]);
+	auto board = std::stoull(argv[3], nullptr, 16);
+	auto size = argc > 4 ? std::stoul(argv[4]) : 4;
+	auto limit = argc > 5 ? parse_limit(argv[5]) : SearchLimit{2, {}};
+
+	static const char * move_names[] = {"up", "left", "down", "right"};
+	auto move = best_move(client, board, size, limit);
+	std::cout << "Best move: " << (move ? move_names[static_cast<int>(*move)] : "none") << "\n";
+	return 0;
+}
+
+static int bench(int argc, char ** argv) {
+	MoveClient client(argv[2]);
+	auto requests = std::stoul(argv[3]);
+	auto limit = argc > 4 ? parse_limit(argv[4]) : SearchLimit{1, {}};
+	if (!requests) {
+		usage();
+		return 1;
+	}
+
+	// positions from real games rather than random noise, so the cache behaves as it would for a bot
+	std::vector<std::uint64_t> boards;
+	Game game(1);
+	game.clear();
+	for (unsigned long i = 0; boards.size() < requests; i++) {
+		if (game.get_state() == GameState::Lose) {
+			game.clear();
+		}
+		boards.push_back(game.get_board().raw());
+		game.apply(all_moves[i * 7 % 4]);
+		game.apply(all_moves[(i + 1) % 4]);
+	}
+
+	std::vector<double> latencies;
+	latencies.reserve(requests);
+	for (auto board : boards) {
+		auto start = std::chrono::steady_clock::now();
+		best_move(client, board, 4, limit);
+		std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+		latencies.push_back(elapsed.count());
+	}
+
+	std::sort(latencies.begin(), latencies.end());
+	auto percentile = [&](double p) {
+		return latencies[static_cast<std::size_t>(p * static_cast<double>(latencies.size() - 1))];
+	};
+	std::cout << "p50 " << percentile(.5) << "us, p99 " << percentile(.99) << "us, max " << latencies.back() << "us\n";
+	return 0;
+}
+
+int main(int argc, char ** argv) {
+	try {
+		std::string command = argc > 1 ? argv[1] : "";
+		if (command == "serve" && argc >= 3) {
+			return serve(argc, argv);
+		} else if (command == "query" && argc >= 4 && argc <= 6) {
+			return query(argc, argv);
+		} else if (command == "bench" && argc >= 4 && argc <= 5) {
+			return bench(argc, argv);
+		}
+	} catch (const std::exception & e) {
+		std::cerr << e.what() << "\n";
+		return 1;
+	}
+
+	usage();
+	return 1;
+}
@@ -0,0 +1,34 @@
+// SPDX-FileCopyrightText: 2022 metaquarx <metaquarx@protonmail.com>
+// SPDX-License-Identifier: GPL-3.0-only
+
+#include "SharedMemory.hpp"
+
+#include <stdexcept>
+
+#include <sys/mman.h>
+
+#if !defined(MAP_ANONYMOUS) && defined(MAP_ANON)
+#define MAP_ANONYMOUS MAP_ANON
+#endif
+
+SharedMemory::SharedMemory(std::size_t size)
+: m_data(nullptr)
+, m_size(size) {
+	void * memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (memory == MAP_FAILED) {
+		throw std::runtime_error("Unable to map shared memory");
+	}
+	m_data = static_cast<std::byte *>(memory);
+}
+
+SharedMemory::~SharedMemory() {
+	munmap(m_data, m_size);
+}
+
+std::byte * SharedMemory::get_data() const {
+	return m_data;
+}
+
+std::size_t SharedMemory::get_size() const {
+	return m_size;
+}
@@ -0,0 +1,24 @@
+// SPDX-FileCopyrightText: 2022 metaquarx <metaquarx@protonmail.com>
+// SPDX-License-Identifier: GPL-3.0-only
+
+#pragma once
+
+#include <cstddef>
+
+// Zeroed memory shared with every process forked after it was made, so
+// workers can hand results back to their parent without pipes or copies
+class SharedMemory {
+public:
+	explicit SharedMemory(std::size_t size);
+	~SharedMemory();
+
+	SharedMemory(const SharedMemory &) = delete;
+	SharedMemory & operator=(const SharedMemory &) = delete;
+
+	std::byte * get_data() const;
+	std::size_t get_size() const;
+
+private:
+	std::byte * m_data;
+	std::size_t m_size;
+};
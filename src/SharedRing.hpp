@@ -0,0 +1,95 @@
+// SPDX-FileCopyrightText: 2022 metaquarx <metaquarx@protonmail.com>
+// SPDX-License-Identifier: GPL-3.0-only
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+
+// Queue from one producer to one consumer, in memory that may be shared
+// between processes (see SharedMemory), without locks or system calls.
+//
+// Values are copied in and out as raw bytes, so they have to be trivially
+// copyable. The read and write positions only ever grow and sit on cache
+// lines of their own, so the two sides never write to the same line.
+template <typename T>
+class SharedRing {
+public:
+	static_assert(std::is_trivially_copyable_v<T>, "Values are copied as bytes");
+	static_assert(std::atomic<std::uint64_t>::is_always_lock_free, "Positions are shared between processes");
+
+	// Bytes a ring holding capacity values (a power of two) takes up
+	static constexpr std::size_t bytes_needed(std::size_t capacity) {
+		return sizeof(Positions) + capacity * sizeof(T);
+	}
+
+	// Starts an empty ring in memory, which has to be zeroed and cache line aligned
+	SharedRing(std::byte * memory, std::size_t capacity)
+	: m_positions(new (memory) Positions)
+	, m_values(reinterpret_cast<T *>(memory + sizeof(Positions)))
+	, m_capacity(capacity) {
+		if (!capacity || (capacity & (capacity - 1))) {
+			throw std::invalid_argument("Ring capacity must be a power of two");
+		}
+	}
+
+	// Producer only. Waits for the consumer whenever the ring is full, as long
+	// as consumer_alive() says there still is one. False if it gave up
+	template <typename Alive>
+	bool push(const T * values, std::size_t count, Alive consumer_alive) {
+		auto head = m_positions->head.load(std::memory_order_relaxed);
+		while (count) {
+			auto space = m_capacity - (head - m_positions->tail.load(std::memory_order_acquire));
+			if (!space) {
+				if (!consumer_alive()) {
+					return false;
+				}
+				std::this_thread::yield();
+				continue;
+			}
+
+			auto batch = std::min<std::size_t>(count, space);
+			auto first = std::min(batch, m_capacity - (head & (m_capacity - 1)));
+			std::memcpy(m_values + (head & (m_capacity - 1)), values, first * sizeof(T));
+			std::memcpy(m_values, values + first, (batch - first) * sizeof(T));
+
+			head += batch;
+			m_positions->head.store(head, std::memory_order_release);
+
+			values += batch;
+			count -= batch;
+		}
+		return true;
+	}
+
+	// Consumer only. Takes up to max_count values, returns how many
+	std::size_t pop(T * values, std::size_t max_count) {
+		auto tail = m_positions->tail.load(std::memory_order_relaxed);
+		auto available = m_positions->head.load(std::memory_order_acquire) - tail;
+		auto count = std::min<std::size_t>(max_count, available);
+
+		auto first = std::min(count, m_capacity - (tail & (m_capacity - 1)));
+		std::memcpy(values, m_values + (tail & (m_capacity - 1)), first * sizeof(T));
+		std::memcpy(values + first, m_values, (count - first) * sizeof(T));
+
+		m_positions->tail.store(tail + count, std::memory_order_release);
+		return count;
+	}
+
+private:
+	struct Positions {
+		alignas(64) std::atomic<std::uint64_t> head{0};
+		alignas(64) std::atomic<std::uint64_t> tail{0};
+	};
+
+	Positions * m_positions;
+	T * m_values;
+	std::size_t m_capacity;
+};
@@ -5,102 +5,399 @@
 
 #include "TextTools.hpp"
 
+#include <SFML/OpenGL.hpp>
+
+#include <algorithm>
+#include <cctype>
 #include <exception>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+// Autoplay runs in moves per second on a fixed step, separate from the frame rate
+constexpr unsigned min_autoplay_rate = 1;
+constexpr unsigned max_autoplay_rate = 1 << 17;
+// Above this rate there is no time to show every slide, so only the newest board is drawn
+constexpr unsigned max_animated_rate = 8;
+// Input and the game are stepped this often, whatever the display's rate
+constexpr float update_rate = 240.f;
+// Benchmarks step and draw as if on a display this fast, and count frames
+// that took longer than it leaves
+constexpr float benchmark_frame_rate = 60.f;
+// Frames drawn after the last benchmark move, so its slide finishes
+constexpr unsigned benchmark_settle_frames = 60;
+
+// The moves of a benchmark script file
+static std::vector<Move> read_script(const std::string & path) {
+	std::ifstream file(path);
+	if (!file) {
+		throw std::runtime_error("Unable to open " + path);
+	}
 
-TFE::TFE()
-: m_window({600, 800}, "Twenty Forty-Eight", sf::Style::Titlebar | sf::Style::Close, sf::ContextSettings{0, 0, 8})
+	std::vector<Move> moves;
+	char letter;
+	while (file >> letter) {
+		switch (std::tolower(static_cast<unsigned char>(letter))) {
+			case 'u': moves.push_back(Move::Up); break;
+			case 'l': moves.push_back(Move::Left); break;
+			case 'd': moves.push_back(Move::Down); break;
+			case 'r': moves.push_back(Move::Right); break;
+			default: throw std::runtime_error(path + " should only hold the letters u, l, d and r");
+		}
+	}
+	return moves;
+}
+
+static sf::Event key_event(sf::Keyboard::Key key) {
+	sf::Event event{};
+	event.type = sf::Event::KeyPressed;
+	event.key.code = key;
+	return event;
+}
+
+TFE::TFE(const Settings & settings)
+: m_open(true)
+, m_rendering(true)
+, m_settings(settings)
+, m_table(settings.cache_megabytes << 20)
+, m_autoplay(false)
+, m_autoplay_rate(4)
 , m_cursor_hand(false) {
-	m_window.setVerticalSyncEnabled(true);
+	// benchmarks draw offscreen, so they never open a window, not even briefly
+	if (!m_settings.benchmark) {
+		m_window.create({600, 800}, "Twenty Forty-Eight", sf::Style::Titlebar | sf::Style::Close, sf::ContextSettings{0, 0, 8});
+		m_window.setVerticalSyncEnabled(true);
 
-	m_cursor.loadFromSystem(sf::Cursor::Arrow);
-	m_window.setMouseCursor(m_cursor);
+		m_cursor.loadFromSystem(sf::Cursor::Arrow);
+		m_window.setMouseCursor(m_cursor);
+	}
 
 	m_fonts.reserve(2);
 	if (!m_fonts["bold"].loadFromFile("resources/ClearSans-Bold.ttf") ||
 		!m_fonts["regular"].loadFromFile("resources/ClearSans-Regular.ttf")) {
 		throw std::runtime_error("Unable to open fonts");
 	}
-	m_grid.emplace(m_fonts.at("bold"));
+	std::optional<std::uint64_t> seed;
+	if (m_settings.benchmark) {
+		seed = m_settings.benchmark->seed;
+	}
+	// every glyph is loaded before any text that goes into a frame is laid
+	// out, the UI last, since loading a glyph invalidates text already laid out
+	m_grid = make_grid(m_settings.board_size, m_fonts.at("bold"), &m_table, seed);
+	if (m_settings.arena_boards) {
+		m_arena = std::make_unique<Arena>(m_settings.arena_boards, m_fonts.at("bold"), sf::Vector2f{600, 800});
+		m_autoplay = true;
+	}
 	m_ui.set_font(m_fonts.at("regular"), m_fonts.at("bold"));
 
 	m_grid->clear();
+
+	if (m_settings.benchmark) {
+		// drawn offscreen instead, by benchmark()
+		return;
+	}
+
+	// the arena's searches never reach the table, so it has nothing to add
+	if (m_settings.cache_file && !m_arena) {
+		m_table.load(*m_settings.cache_file, table_tag(m_settings.board_size, HeuristicWeights{}));
+	}
+
+	// the window is drawn on its own thread from here on, events stay on this one
+	publish();
+	m_window.setActive(false);
+	m_render_thread = std::thread([this] { render(); });
+}
+
+TFE::~TFE() {
+	m_rendering = false;
+	if (m_render_thread.joinable()) {
+		m_render_thread.join();
+	}
+
+	if (m_settings.cache_file && !m_settings.benchmark && !m_arena) {
+		m_table.save(*m_settings.cache_file, table_tag(m_settings.board_size, HeuristicWeights{}));
+	}
 }
 
 bool TFE::run() {
 	events();
-	update();
-	draw();
-	return m_window.isOpen();
+	update(m_clock.restart().asSeconds());
+	publish();
+
+	if (!m_open) {
+		m_rendering = false;
+		m_render_thread.join();
+		m_window.close();
+		return false;
+	}
+
+	auto tick = sf::seconds(1.f / update_rate);
+	auto spent = m_tick_clock.getElapsedTime();
+	if (spent < tick) {
+		sf::sleep(tick - spent);
+	}
+	m_tick_clock.restart();
+	return true;
 }
 
 void TFE::events() {
 	sf::Event event;
 	while (m_window.pollEvent(event)) {
-		if (event.type == sf::Event::Closed) {
-			m_window.close();
-		} else if (event.type == sf::Event::MouseMoved) {
-			auto position = m_window.mapPixelToCoords({event.mouseMove.x, event.mouseMove.y});
-
-			if (m_ui.m_tutorial_button_text.getGlobalBounds().contains(position) ||
-				m_ui.m_new_game_button.getGlobalBounds().contains(position)) {
-				show_cursor_hand(true);
-			} else {
-				show_cursor_hand(false);
+		handle(event);
+	}
+}
+
+void TFE::handle(const sf::Event & event) {
+	if (event.type == sf::Event::Closed) {
+		m_open = false;
+	} else if (m_arena && event.type != sf::Event::KeyPressed) {
+		// the arena has no buttons
+	} else if (event.type == sf::Event::MouseMoved) {
+		auto position = m_window.mapPixelToCoords({event.mouseMove.x, event.mouseMove.y});
+
+		if (m_ui.m_tutorial_button_text.getGlobalBounds().contains(position) ||
+			m_ui.m_new_game_button.getGlobalBounds().contains(position)) {
+			show_cursor_hand(true);
+		} else {
+			show_cursor_hand(false);
+		}
+	} else if (event.type == sf::Event::MouseButtonReleased) {
+		auto position = m_window.mapPixelToCoords({event.mouseButton.x, event.mouseButton.y});
+
+		if (m_ui.m_tutorial_button_text.getGlobalBounds().contains(position)) {
+			m_ui.m_busy ? m_ui.clear() : m_ui.show_tutorial();
+		} else if (m_ui.m_new_game_button.getGlobalBounds().contains(position)) {
+			m_grid->clear();
+			m_table.new_search();
+			m_ui.clear();			}
+	} else if (event.type == sf::Event::KeyPressed) {
+		if (event.key.code == sf::Keyboard::Escape && m_ui.m_busy) {
+			m_ui.clear();
+		} else if (event.key.code == sf::Keyboard::Escape) {
+			m_open = false;
+		} else if (event.key.code == sf::Keyboard::N) {
+			m_ui.clear();
+			m_grid->clear();
+			m_table.new_search();
+			if (m_arena) {
+				m_arena->restart();
 			}
-		} else if (event.type == sf::Event::MouseButtonReleased) {
-			auto position = m_window.mapPixelToCoords({event.mouseButton.x, event.mouseButton.y});
-
-			if (m_ui.m_tutorial_button_text.getGlobalBounds().contains(position)) {
-				m_ui.m_busy ? m_ui.clear() : m_ui.show_tutorial();
-			} else if (m_ui.m_new_game_button.getGlobalBounds().contains(position)) {
-				m_grid->clear();
-				m_ui.clear();			}
-		} else if (event.type == sf::Event::KeyPressed) {
-			if (event.key.code == sf::Keyboard::Escape && m_ui.m_busy) {
+		} else if (event.key.code == sf::Keyboard::P) {
+			m_autoplay = !m_autoplay;
+			m_autoplay_steps.reset();
+		} else if (event.key.code == sf::Keyboard::Equal || event.key.code == sf::Keyboard::Add) {
+			m_autoplay_rate = std::min(m_autoplay_rate * 2, max_autoplay_rate);
+		} else if (event.key.code == sf::Keyboard::Hyphen || event.key.code == sf::Keyboard::Subtract) {
+			m_autoplay_rate = std::max(m_autoplay_rate / 2, min_autoplay_rate);
+		} else if (m_arena) {
+			// the arena only takes the keys above
+		} else if (event.key.code == sf::Keyboard::Z) {
+			if (m_grid->undo()) {
 				m_ui.clear();
-			} else if (event.key.code == sf::Keyboard::Escape) {
-				m_window.close();
-			} else if (event.key.code == sf::Keyboard::N) {
+			}
+		} else if (event.key.code == sf::Keyboard::Y) {
+			if (m_grid->redo()) {
 				m_ui.clear();
-				m_grid->clear();
-			} else if (m_ui.m_busy) {
-				// skip next checks
-			} else if (event.key.code == sf::Keyboard::W || event.key.code == sf::Keyboard::Up) {
-				m_grid->queue_input(Move::Up);
-			} else if (event.key.code == sf::Keyboard::A || event.key.code == sf::Keyboard::Left) {
-				m_grid->queue_input(Move::Left);
-			} else if (event.key.code == sf::Keyboard::S || event.key.code == sf::Keyboard::Down) {
-				m_grid->queue_input(Move::Down);
-			} else if (event.key.code == sf::Keyboard::D || event.key.code == sf::Keyboard::Right) {
-				m_grid->queue_input(Move::Right);
 			}
+		} else if (m_ui.m_busy) {
+			// skip next checks
+		} else if (event.key.code == sf::Keyboard::W || event.key.code == sf::Keyboard::Up) {
+			m_grid->queue_input(Move::Up);
+		} else if (event.key.code == sf::Keyboard::A || event.key.code == sf::Keyboard::Left) {
+			m_grid->queue_input(Move::Left);
+		} else if (event.key.code == sf::Keyboard::S || event.key.code == sf::Keyboard::Down) {
+			m_grid->queue_input(Move::Down);
+		} else if (event.key.code == sf::Keyboard::D || event.key.code == sf::Keyboard::Right) {
+			m_grid->queue_input(Move::Right);
 		}
 	}
 }
 
-void TFE::update() {
-	float dt = m_clock.restart().asSeconds();
+void TFE::update(float dt) {
+	if (m_arena) {
+		if (m_autoplay) {
+			m_arena->update(dt, m_autoplay_rate);
+		}
+		return;
+	}
+
+	if (m_autoplay) {
+		autoplay(dt);
+	}
 
 	m_ui.update(dt);
 	m_grid->update(dt);
 	m_ui.update_score(m_grid->get_score());
 
 	auto state = m_grid->get_state();
-	if (state == Grid::GameState::Lose) {
+	if (state == GameState::Lose) {
 		m_ui.show_lose_screen();
-	} else if (state == Grid::GameState::Win) {
+	} else if (state == GameState::Win) {
 		m_ui.show_win_screen();
 		m_grid->pass();
 	}
 }
 
-void TFE::draw() {
-	m_window.clear(sf::Color(250, 248, 239));
+void TFE::autoplay(float dt) {
+	if (m_ui.m_busy || m_grid->get_state() != GameState::Ongoing) {
+		m_autoplay_steps.reset();
+		return;
+	}
 
-	m_window.draw(m_grid.value());
-	m_window.draw(m_ui);
+	bool animated = m_autoplay_rate <= max_animated_rate;
+	bool advanced = false;
+	m_autoplay_steps.update(dt, 1.f / static_cast<float>(m_autoplay_rate), [&] {
+		// slides are shown one at a time, so one is queued per update at most
+		if (animated) {
+			if (!m_grid->input_pending()) {
+				if (auto move = m_grid->suggest_move()) {
+					m_grid->queue_input(*move);
+				}
+			}
+			return false;
+		}
+
+		auto move = m_grid->suggest_move();
+		if (!move) {
+			return false;
+		}
+		m_grid->advance(*move);
+		advanced = true;
+		return m_grid->get_state() == GameState::Ongoing;
+	});
+
+	if (advanced) {
+		m_grid->sync();
+	}
+}
+
+void TFE::publish() {
+	auto & frame = m_frames.back();
+	frame.show_arena = static_cast<bool>(m_arena);
+	if (m_arena) {
+		m_arena->snapshot(frame.arena);
+	} else {
+		m_grid->snapshot(frame.grid);
+		frame.ui = m_ui;
+	}
+	m_frames.publish();
+}
+
+void TFE::render() {
+	m_window.setActive(true);
+
+	while (m_rendering) {
+		// the newest frame, or the last one again if the game hasn't moved on
+		m_frames.update();
+		const auto & frame = m_frames.front();
+
+		draw_frame(m_window, frame);
+		m_window.display();
+	}
+
+	m_window.setActive(false);
+}
+
+void TFE::draw_frame(sf::RenderTarget & target, const Frame & frame) {
+	target.clear(sf::Color(250, 248, 239));
+	if (frame.show_arena) {
+		target.draw(frame.arena);
+	} else {
+		target.draw(frame.grid);
+		target.draw(frame.ui);
+	}
+}
+
+void TFE::benchmark() {
+	const auto & settings = *m_settings.benchmark;
+	if (m_arena) {
+		throw std::invalid_argument("The arena can't be benchmarked, its games are random");
+	}
+
+	// the AI's moves are picked up front on a copy of the game, so picking them isn't timed
+	std::vector<Move> moves;
+	if (settings.script) {
+		moves = read_script(*settings.script);
+	} else {
+		auto script_grid = make_grid(m_settings.board_size, m_fonts.at("bold"), &m_table, settings.seed);
+		script_grid->clear();
+		m_table.new_search();
+		while (moves.size() < settings.moves) {
+			if (script_grid->get_state() == GameState::Win) {
+				script_grid->pass();
+			}
+			auto move = script_grid->suggest_move();
+			if (!move) {
+				break;
+			}
+			script_grid->advance(*move);
+			moves.push_back(*move);
+		}
+	}
+
+	sf::RenderTexture target;
+	if (!target.create(600, 800, sf::ContextSettings{0, 0, 8})) {
+		throw std::runtime_error("Unable to create an offscreen render target");
+	}
+
+	static constexpr sf::Keyboard::Key keys[] = {sf::Keyboard::Up, sf::Keyboard::Left, sf::Keyboard::Down, sf::Keyboard::Right};
+	float dt = 1.f / benchmark_frame_rate;
+	float move_interval = 1.f / static_cast<float>(std::max(settings.rate, 1u));
+	float until_move = 0.f;
+	std::size_t next_move = 0;
+	unsigned settle_frames = benchmark_settle_frames;
+
+	// the same events, time steps and draws as a player at a 60Hz display, timed from input to the finished frame
+	std::vector<float> frame_times;
+	sf::Clock frame_clock;
+	while (next_move < moves.size() || settle_frames--) {
+		frame_clock.restart();
+
+		for (until_move -= dt; next_move < moves.size() && until_move <= 0.f; until_move += move_interval) {
+			// dismisses the win screen, like a player carrying on would
+			if (m_ui.m_busy) {
+				handle(key_event(sf::Keyboard::Escape));
+			}
+			handle(key_event(keys[static_cast<std::size_t>(moves[next_move++])]));
+		}
+
+		update(dt);
+		publish();
+		m_frames.update();
+		draw_frame(target, m_frames.front());
+		target.display();
+		// draws are only queued up to here, a frame isn't done until the GPU is
+		glFinish();
+
+		frame_times.push_back(static_cast<float>(frame_clock.getElapsedTime().asMicroseconds()) / 1000.f);
+	}
+
+	if (settings.frame_times) {
+		std::ofstream file(*settings.frame_times);
+		for (auto time : frame_times) {
+			file << time << "\n";
+		}
+		if (!file) {
+			throw std::runtime_error("Unable to write " + *settings.frame_times);
+		}
+	}
+
+	auto sorted = frame_times;
+	std::sort(sorted.begin(), sorted.end());
+	auto percentile = [&](double p) {
+		return sorted[static_cast<std::size_t>(p * static_cast<double>(sorted.size() - 1))];
+	};
+	double total = 0.;
+	for (auto time : sorted) {
+		total += time;
+	}
+	float budget = 1000.f / benchmark_frame_rate;
+	auto over_budget = sorted.end() - std::upper_bound(sorted.begin(), sorted.end(), budget);
 
-	m_window.display();
+	std::cout << "Played " << moves.size() << " moves in " << sorted.size() << " frames\n"
+		<< "Frame time: mean " << total / static_cast<double>(sorted.size()) << "ms, p95 " << percentile(.95)
+		<< "ms, p99 " << percentile(.99) << "ms, max " << sorted.back() << "ms\n"
+		<< "Over the " << budget << "ms budget: " << over_budget << " frames\n";
 }
 
 void TFE::show_cursor_hand(bool on) {
@@ -3,32 +3,95 @@
 
 #pragma once
 
+#include "Arena.hpp"
+#include "FixedStep.hpp"
 #include "Grid.hpp"
 #include "Sqroundre.hpp"
+#include "TranspositionTable.hpp"
+#include "TripleBuffer.hpp"
 #include "UI.hpp"
 
 #include <SFML/Graphics.hpp>
 
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <optional>
 #include <unordered_map>
 #include <string>
+#include <thread>
 
 class TFE {
 public:
-	TFE();
+	// Plays the same moves at the same pace every run, drawing offscreen, to
+	// compare how smoothly different builds render real games
+	struct Benchmark {
+		// moves the AI picks, unless a script gives them
+		std::size_t moves = 1000;
+		// a file of u, l, d and r letters, one per move
+		std::optional<std::string> script;
+		// moves per second
+		unsigned rate = 8;
+		std::uint64_t seed = 1;
+		// where to write every frame's time in milliseconds, one per line
+		std::optional<std::string> frame_times;
+	};
+
+	struct Settings {
+		std::size_t board_size = 4;
+		// watch this many AI games at once instead of playing one
+		std::size_t arena_boards = 0;
+		std::size_t cache_megabytes = 64;
+		std::optional<std::string> cache_file;
+		std::optional<Benchmark> benchmark;
+	};
+
+	explicit TFE(const Settings & settings);
+	~TFE();
+	// Handles input and steps the game once, false once the window is closed
 	bool run();
+	// Plays the benchmark in the settings and prints how long frames took
+	void benchmark();
 
 private:
 	sf::RenderWindow m_window;
 	sf::Clock m_clock;
+	sf::Clock m_tick_clock;
+	bool m_open;
 
 	std::unordered_map<std::string, sf::Font> m_fonts;
 
-	std::optional<Grid> m_grid;
+	std::unique_ptr<GridBase> m_grid;
+	std::unique_ptr<Arena> m_arena;
 	UI m_ui;
 
 	void events();
-	void update();
-	void draw();
+	void handle(const sf::Event & event);
+	void update(float dt);
+	void publish();
+
+	// What the render thread draws, copied out at the end of every update
+	struct Frame {
+		GridSnapshot grid;
+		UI ui;
+		ArenaSnapshot arena;
+		bool show_arena = false;
+	};
+	TripleBuffer<Frame> m_frames;
+	// sf::Font loads glyphs lazily and isn't thread safe. Every glyph the game
+	// can show is loaded at startup and text is laid out before it goes into a
+	// frame, so the render thread only reads the fonts' textures.
+	std::atomic<bool> m_rendering;
+	std::thread m_render_thread;
+	void render();
+	static void draw_frame(sf::RenderTarget & target, const Frame & frame);
+
+	Settings m_settings;
+	TranspositionTable m_table;
+	bool m_autoplay;
+	unsigned m_autoplay_rate;
+	FixedStep m_autoplay_steps;
+	void autoplay(float dt);
 
 	void show_cursor_hand(bool on);
 	sf::Cursor m_cursor;
@@ -0,0 +1,348 @@
+// SPDX-FileCopyrightText: 2022 metaquarx <metaquarx@protonmail.com>
+// SPDX-License-Identifier: GPL-3.0-only
+
+#include "Tablebase.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace {
+
+constexpr std::array<char, 8> tablebase_magic{'T', 'F', 'E', 'T', 'B', 'A', 'S', 'E'};
+// stores one board for each set of symmetric boards
+constexpr std::uint32_t tablebase_version = 2;
+constexpr std::uint8_t no_move = 4;
+
+struct Header {
+	std::array<char, 8> magic;
+	std::uint32_t version;
+	std::uint32_t size;
+	std::uint32_t goal;
+	std::uint32_t reserved;
+	std::uint64_t count;
+	std::uint64_t capacity;
+	std::array<std::uint64_t, 3> padding;
+};
+static_assert(sizeof(Header) == 64);
+
+template <typename F>
+void parallel_for(std::size_t count, unsigned threads, F function) {
+	threads = std::max(1u, std::min(threads, static_cast<unsigned>(std::max<std::size_t>(count / 1024, 1))));
+
+	std::vector<std::thread> workers;
+	workers.reserve(threads);
+	for (unsigned i = 0; i < threads; i++) {
+		workers.emplace_back([&, i] {
+			function(count * i / threads, count * (i + 1) / threads, i);
+		});
+	}
+	for (auto & worker : workers) {
+		worker.join();
+	}
+}
+
+template <std::size_t N>
+class Generator {
+public:
+	Generator(unsigned goal, unsigned threads)
+	: m_goal(goal)
+	, m_threads(threads) {
+	}
+
+	void enumerate() {
+		// every way of spawning the first two tiles
+		for (std::size_t i = 0; i < cells; i++) {
+			for (std::size_t j = i + 1; j < cells; j++) {
+				for (std::uint64_t a = 1; a <= 2; a++) {
+					for (std::uint64_t b = 1; b <= 2; b++) {
+						auto board = canonical((a << (4 * i)) | (b << (4 * j)));
+						m_layers[tile_sum(board)].boards.push_back(board);
+					}
+				}
+			}
+		}
+
+		// moving never changes the tile sum and spawning always raises it, so
+		// a layer is complete by the time every smaller sum has been expanded
+		for (auto & [sum, layer] : m_layers) {
+			std::sort(layer.boards.begin(), layer.boards.end());
+			layer.boards.erase(std::unique(layer.boards.begin(), layer.boards.end()), layer.boards.end());
+
+			std::vector<std::array<std::vector<std::uint64_t>, 2>> found(m_threads);
+			parallel_for(layer.boards.size(), m_threads, [&](std::size_t begin, std::size_t end, unsigned thread) {
+				auto & local = found[thread];
+				for (std::size_t i = begin; i < end; i++) {
+					for (auto move : all_moves) {
+						auto moved = move_board(layer.boards[i], move);
+						if (moved == layer.boards[i] || won(moved)) {
+							continue;
+						}
+
+						for_each_spawn(moved, [&](std::uint64_t next, unsigned value) {
+							local[value - 1].push_back(canonical(next));
+						});
+					}
+				}
+
+				for (auto & next : local) {
+					std::sort(next.begin(), next.end());
+					next.erase(std::unique(next.begin(), next.end()), next.end());
+				}
+			});
+
+			for (unsigned value = 1; value <= 2; value++) {
+				for (auto & local : found) {
+					if (local[value - 1].size()) {
+						auto & next = m_layers[sum + (1u << value)].boards;
+						next.insert(next.end(), local[value - 1].begin(), local[value - 1].end());
+					}
+				}
+			}
+		}
+	}
+
+	void solve() {
+		for (auto it = m_layers.rbegin(); it != m_layers.rend(); it++) {
+			auto sum = it->first;
+			auto & layer = it->second;
+			layer.probabilities.resize(layer.boards.size());
+			layer.moves.resize(layer.boards.size());
+
+			std::array<const Layer *, 2> next{find_layer(sum + 2), find_layer(sum + 4)};
+
+			parallel_for(layer.boards.size(), m_threads, [&](std::size_t begin, std::size_t end, unsigned) {
+				for (std::size_t i = begin; i < end; i++) {
+					double best = 0.;
+					std::uint8_t best_move = no_move;
+
+					for (std::uint8_t m = 0; m < all_moves.size(); m++) {
+						auto moved = move_board(layer.boards[i], all_moves[m]);
+						if (moved == layer.boards[i]) {
+							continue;
+						}
+
+						double value = 1.;
+						if (!won(moved)) {
+							double total = 0.;
+							unsigned count = 0;
+							for_each_spawn(moved, [&](std::uint64_t spawned, unsigned spawn_value) {
+								total += next[spawn_value - 1]->probability_of(canonical(spawned));
+								count++;
+							});
+							value = total / count;
+						}
+
+						if (best_move == no_move || value > best) {
+							best = value;
+							best_move = m;
+						}
+					}
+
+					layer.probabilities[i] = static_cast<float>(best);
+					layer.moves[i] = best_move;
+				}
+			});
+		}
+	}
+
+	std::uint64_t write(const std::string & path) const {
+		std::uint64_t count = 0;
+		for (auto & [sum, layer] : m_layers) {
+			count += layer.boards.size();
+		}
+
+		std::uint64_t capacity = 16;
+		while (capacity < count + count / 3) {
+			capacity *= 2;
+		}
+
+		std::vector<std::uint64_t> keys(capacity, 0);
+		std::vector<float> probabilities(capacity, 0.f);
+		std::vector<std::uint8_t> moves(capacity, no_move);
+		for (auto & [sum, layer] : m_layers) {
+			for (std::size_t i = 0; i < layer.boards.size(); i++) {
+				auto slot = hash_cells(layer.boards[i]) & (capacity - 1);
+				while (keys[slot]) {
+					slot = (slot + 1) & (capacity - 1);
+				}
+				keys[slot] = layer.boards[i];
+				probabilities[slot] = layer.probabilities[i];
+				moves[slot] = layer.moves[i];
+			}
+		}
+
+		Header header{};
+		header.magic = tablebase_magic;
+		header.version = tablebase_version;
+		header.size = static_cast<std::uint32_t>(N);
+		header.goal = m_goal;
+		header.count = count;
+		header.capacity = capacity;
+
+		std::ofstream file(path, std::ios::binary | std::ios::trunc);
+		file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+		file.write(reinterpret_cast<const char *>(keys.data()), static_cast<std::streamsize>(capacity * sizeof(std::uint64_t)));
+		file.write(reinterpret_cast<const char *>(probabilities.data()), static_cast<std::streamsize>(capacity * sizeof(float)));
+		file.write(reinterpret_cast<const char *>(moves.data()), static_cast<std::streamsize>(capacity));
+		if (!file) {
+			throw std::runtime_error("Unable to write " + path);
+		}
+
+		return count;
+	}
+
+private:
+	static constexpr std::size_t cells = N * N;
+
+	static std::uint64_t move_board(std::uint64_t board, Move move) {
+		return BasicBoard<N>(board).moved(move).board.raw();
+	}
+
+	// only canonical boards are enumerated and solved, which is up to 8 times fewer
+	static std::uint64_t canonical(std::uint64_t board) {
+		return BasicBoard<N>(board).canonical_key();
+	}
+
+	struct Layer {
+		std::vector<std::uint64_t> boards;
+		std::vector<float> probabilities;
+		std::vector<std::uint8_t> moves;
+
+		float probability_of(std::uint64_t board) const {
+			auto it = std::lower_bound(boards.begin(), boards.end(), board);
+			return probabilities[static_cast<std::size_t>(it - boards.begin())];
+		}
+	};
+
+	unsigned m_goal;
+	unsigned m_threads;
+	std::map<std::uint64_t, Layer> m_layers;
+
+	const Layer * find_layer(std::uint64_t sum) const {
+		auto it = m_layers.find(sum);
+		return it == m_layers.end() ? nullptr : &it->second;
+	}
+
+	bool won(std::uint64_t board) const {
+		for (std::size_t i = 0; i < cells; i++) {
+			if (((board >> (4 * i)) & 0xF) >= m_goal) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	static std::uint64_t tile_sum(std::uint64_t board) {
+		std::uint64_t sum = 0;
+		for (std::size_t i = 0; i < cells; i++) {
+			auto value = (board >> (4 * i)) & 0xF;
+			sum += value ? std::uint64_t{1} << value : 0;
+		}
+		return sum;
+	}
+
+	// every spawn pick_spawn can make, which are all equally likely
+	template <typename F>
+	static void for_each_spawn(std::uint64_t board, F function) {
+		for (std::size_t i = 0; i < cells; i++) {
+			if (((board >> (4 * i)) & 0xF) == 0) {
+				function(board | (std::uint64_t{1} << (4 * i)), 1u);
+				function(board | (std::uint64_t{2} << (4 * i)), 2u);
+			}
+		}
+	}
+};
+
+template <std::size_t N>
+std::pair<std::uint64_t, Symmetry> canonical_of(std::uint64_t board) {
+	auto canonical = BasicBoard<N>(board).canonical();
+	return {canonical.board.raw(), canonical.symmetry};
+}
+
+template <std::size_t N>
+std::uint64_t generate_with(const std::string & path, unsigned goal, unsigned threads) {
+	Generator<N> generator(goal, threads);
+	generator.enumerate();
+	generator.solve();
+	return generator.write(path);
+}
+
+}
+
+Tablebase::Tablebase(const std::string & path)
+: m_file(path) {
+	Header header;
+	if (m_file.get_size() < sizeof(header)) {
+		throw std::runtime_error("Not a tablebase: " + path);
+	}
+	std::memcpy(&header, m_file.get_data(), sizeof(header));
+
+	if (header.magic != tablebase_magic || header.version != tablebase_version) {
+		throw std::runtime_error("Not a tablebase: " + path);
+	}
+	if (m_file.get_size() != sizeof(header) + header.capacity * (sizeof(std::uint64_t) + sizeof(float) + 1)) {
+		throw std::runtime_error("Truncated tablebase: " + path);
+	}
+
+	m_size = header.size;
+	m_goal = header.goal;
+	m_count = header.count;
+	m_mask = header.capacity - 1;
+
+	auto data = m_file.get_data() + sizeof(header);
+	m_keys = reinterpret_cast<const std::uint64_t *>(data);
+	m_probabilities = reinterpret_cast<const float *>(data + header.capacity * sizeof(std::uint64_t));
+	m_moves = reinterpret_cast<const std::uint8_t *>(data + header.capacity * (sizeof(std::uint64_t) + sizeof(float)));
+}
+
+std::optional<Tablebase::Entry> Tablebase::lookup(std::uint64_t board) const {
+	if (!board) {
+		return std::nullopt;
+	}
+
+	// the table holds the canonical board, and its best move has to be turned back
+	auto [key, symmetry] = m_size == 3 ? canonical_of<3>(board) : canonical_of<4>(board);
+	for (auto slot = hash_cells(key) & m_mask; m_keys[slot]; slot = (slot + 1) & m_mask) {
+		if (m_keys[slot] == key) {
+			Entry entry{m_probabilities[slot], std::nullopt};
+			if (m_moves[slot] != no_move) {
+				entry.best_move = transformed_move(all_moves[m_moves[slot]], inverse_symmetry(symmetry));
+			}
+			return entry;
+		}
+	}
+	return std::nullopt;
+}
+
+std::size_t Tablebase::get_size() const {
+	return m_size;
+}
+
+unsigned Tablebase::get_goal() const {
+	return m_goal;
+}
+
+std::uint64_t Tablebase::get_count() const {
+	return m_count;
+}
+
+std::uint64_t Tablebase::generate(const std::string & path, std::size_t size, unsigned goal, unsigned threads) {
+	if (goal < 3 || goal > max_value) {
+		throw std::invalid_argument("Goal tile must be between 8 and 32768");
+	}
+
+	threads = std::max(threads, 1u);
+	if (size == 3) {
+		return generate_with<3>(path, goal, threads);
+	} else if (size == 4) {
+		return generate_with<4>(path, goal, threads);
+	}
+	throw std::invalid_argument("Tablebases are only available for 3x3 and 4x4 boards");
+}
@@ -0,0 +1,50 @@
+// SPDX-FileCopyrightText: 2022 metaquarx <metaquarx@protonmail.com>
+// SPDX-License-Identifier: GPL-3.0-only
+
+#pragma once
+
+#include "Board.hpp"
+#include "MappedFile.hpp"
+
+#include <cstdint>
+#include <optional>
+#include <string>
+
+// Exact win probabilities under perfect play, for boards small enough to
+// enumerate completely (3x3, or 4x4 with a low goal tile).
+//
+// Boards are keyed the same way as Board::raw: one nibble per cell, cell
+// (x, y) in nibble size * y + x. Only the canonical version of each board is
+// stored, and lookups of the others go through it. The table is an open
+// addressed hash table in a memory mapped file, so lookups cost a probe or
+// two and loading is free.
+class Tablebase {
+public:
+	explicit Tablebase(const std::string & path);
+
+	struct Entry {
+		float win_probability;
+		std::optional<Move> best_move;
+	};
+	std::optional<Entry> lookup(std::uint64_t board) const;
+
+	std::size_t get_size() const;
+	unsigned get_goal() const;
+	std::uint64_t get_count() const;
+
+	// Enumerates every position reachable from a new game until the goal tile
+	// is made, solves them back to front and writes the table to path.
+	// Returns the number of positions stored.
+	static std::uint64_t generate(const std::string & path, std::size_t size, unsigned goal, unsigned threads);
+
+private:
+	MappedFile m_file;
+	std::size_t m_size;
+	unsigned m_goal;
+	std::uint64_t m_count;
+	std::uint64_t m_mask;
+
+	const std::uint64_t * m_keys;
+	const float * m_probabilities;
+	const std::uint8_t * m_moves;
+};
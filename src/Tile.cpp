@@ -2,6 +2,7 @@
 // SPDX-License-Identifier: GPL-3.0-only
 
 #include "Tile.hpp"
+#include "Board.hpp"
 #include <cmath>
 #include <limits>
 #include <variant>
@@ -11,7 +12,7 @@ SlideAnim::SlideAnim(sf::Vector2f target, float time)
 , m_end(std::max(time, std::numeric_limits<float>::min())) {
 }
 
-static std::pair<sf::Color, sf::Color> colour_of(unsigned value) {
+std::pair<sf::Color, sf::Color> colour_of(unsigned value) {
 	switch (value) {
 		case 1: return {{238, 228, 218}, {119, 110, 101}};
 		case 2: return {{238, 225, 201}, {119, 110, 101}};
@@ -28,8 +29,9 @@ static std::pair<sf::Color, sf::Color> colour_of(unsigned value) {
 	}
 }
 
-Tile::Tile(const sf::Font & font)
+Tile::Tile(const sf::Font & font, float size)
 : m_value(0)
+, m_size(size)
 , m_progress(1.f)
 , m_fin(false) {
 	m_text.setFont(font);
@@ -38,6 +40,13 @@ Tile::Tile(const sf::Font & font)
 	m_text.setPosition({999, 999});
 }
 
+void Tile::preload(const sf::Font & font, float size) {
+	Tile tile(font, size);
+	for (unsigned value = 1; value <= max_value; value++) {
+		tile.set_value(value);
+	}
+}
+
 bool Tile::operator==(const Tile & other) const {
 	return m_value == other.m_value;
 }
@@ -138,18 +147,18 @@ void Tile::set_value(unsigned new_value) {
 	m_value = new_value;
 	auto new_colours = colour_of(new_value);
 
-	m_graphic.create({129, 129}, 6, new_colours.first, true);
+	m_graphic.create({m_size, m_size}, 6, new_colours.first, true);
 	m_text.setFillColor(new_colours.second);
 	m_text.setString(std::to_string(static_cast<unsigned>(std::pow(2, new_value))));
 
-	unsigned text_size = 64;
+	auto text_size = static_cast<unsigned>(64.f * m_size / 129.f);
 	do {
 		m_text.setCharacterSize(text_size);
 		auto lb = m_text.getLocalBounds();
 		m_text.setOrigin(sf::Vector2f{lb.left + lb.width/2, lb.top + lb.height/2});
 
 		text_size--;
-	} while (m_text.getGlobalBounds().width > 129.f);
+	} while (m_text.getGlobalBounds().width > m_size && text_size > 1);
 }
 
 void Tile::increase_value() {
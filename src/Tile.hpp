@@ -7,6 +7,7 @@
 #include "Sqroundre.hpp"
 #include <deque>
 #include <optional>
+#include <utility>
 #include <variant>
 
 struct SlideAnim {
@@ -22,9 +23,16 @@ struct PopAnim {
 
 constexpr float move_speed = 0.1f;
 
+// Background and text colour of a tile holding value
+std::pair<sf::Color, sf::Color> colour_of(unsigned value);
+
 class Tile : public sf::Drawable {
 public:
-	Tile(const sf::Font & font);
+	Tile(const sf::Font & font, float size = 129.f);
+
+	// Loads every glyph a tile of this size can show, so laying out tiles
+	// later on never adds to the font
+	static void preload(const sf::Font & font, float size = 129.f);
 
 	bool operator==(const Tile & other) const;
 
@@ -41,6 +49,7 @@ public:
 
 private:
 	unsigned m_value;
+	float m_size;
 
 	Sqroundre m_graphic;
 	sf::Text m_text;
@@ -0,0 +1,188 @@
+// SPDX-FileCopyrightText: 2022 metaquarx <metaquarx@protonmail.com>
+// SPDX-License-Identifier: GPL-3.0-only
+
+#include "TranspositionTable.hpp"
+
+#include "Board.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+namespace {
+
+constexpr std::array<char, 8> table_magic{'T', 'F', 'E', 'T', 'R', 'A', 'N', 'S'};
+constexpr std::uint64_t table_version = 4;
+
+// data word layout: value (32 bits) | depth (8 bits) | generation (8 bits)
+std::uint64_t pack(float value, unsigned depth, std::uint8_t generation) {
+	std::uint32_t bits;
+	std::memcpy(&bits, &value, sizeof(bits));
+	return std::uint64_t{bits} | (std::uint64_t{depth & 0xFF} << 32) | (std::uint64_t{generation} << 40);
+}
+
+float value_of(std::uint64_t data) {
+	auto bits = static_cast<std::uint32_t>(data);
+	float value;
+	std::memcpy(&value, &bits, sizeof(value));
+	return value;
+}
+
+unsigned depth_of(std::uint64_t data) {
+	return static_cast<unsigned>((data >> 32) & 0xFF);
+}
+
+std::uint8_t generation_of(std::uint64_t data) {
+	return static_cast<std::uint8_t>(data >> 40);
+}
+
+}
+
+TranspositionTable::TranspositionTable(std::size_t budget_bytes)
+: m_mask(0)
+, m_generation(0) {
+	std::size_t buckets = 1;
+	while (buckets * 2 * sizeof(Bucket) <= budget_bytes) {
+		buckets *= 2;
+	}
+
+	m_buckets.reset(new Bucket[buckets]);
+	m_mask = buckets - 1;
+	clear();
+}
+
+std::optional<float> TranspositionTable::probe(std::uint64_t key, unsigned depth) const {
+	const auto & bucket = m_buckets[hash_cells(key) & m_mask];
+	for (const auto & entry : bucket.entries) {
+		auto data = entry.data.load(std::memory_order_relaxed);
+		auto check = entry.check.load(std::memory_order_relaxed);
+		if ((check ^ data) == key) {
+			if (depth_of(data) >= depth) {
+				return value_of(data);
+			}
+			return std::nullopt;
+		}
+	}
+	return std::nullopt;
+}
+
+void TranspositionTable::store(std::uint64_t key, unsigned depth, float value) {
+	insert(key, pack(value, depth, m_generation.load(std::memory_order_relaxed)));
+}
+
+void TranspositionTable::insert(std::uint64_t key, std::uint64_t data) {
+	auto & bucket = m_buckets[hash_cells(key) & m_mask];
+	auto generation = generation_of(data);
+
+	Entry * victim = nullptr;
+	unsigned victim_score = ~0u;
+	for (auto & entry : bucket.entries) {
+		auto stored = entry.data.load(std::memory_order_relaxed);
+		auto stored_key = entry.check.load(std::memory_order_relaxed) ^ stored;
+
+		if (stored_key == key) {
+			// a deeper result stays whatever search it came from, it just counts as recent again
+			if (depth_of(data) < depth_of(stored)) {
+				if (generation_of(stored) == generation) {
+					return;
+				}
+				data = pack(value_of(stored), depth_of(stored), generation);
+			}
+			victim = &entry;
+			break;
+		}
+
+		// empty first, then anything from an older search, then the shallowest
+		unsigned score = 0;
+		if (stored_key) {
+			score = 1 + depth_of(stored) + (generation_of(stored) == generation ? 256 : 0);
+		}
+		if (score < victim_score) {
+			victim = &entry;
+			victim_score = score;
+		}
+	}
+
+	victim->data.store(data, std::memory_order_relaxed);
+	victim->check.store(key ^ data, std::memory_order_relaxed);
+}
+
+void TranspositionTable::new_search() {
+	m_generation.fetch_add(1, std::memory_order_relaxed);
+}
+
+void TranspositionTable::clear() {
+	for (std::size_t i = 0; i <= m_mask; i++) {
+		for (auto & entry : m_buckets[i].entries) {
+			entry.check.store(0, std::memory_order_relaxed);
+			entry.data.store(0, std::memory_order_relaxed);
+		}
+	}
+}
+
+bool TranspositionTable::save(const std::string & path, std::uint64_t tag) const {
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	std::uint64_t count = get_capacity();
+	file.write(table_magic.data(), static_cast<std::streamsize>(table_magic.size()));
+	file.write(reinterpret_cast<const char *>(&table_version), sizeof(table_version));
+	file.write(reinterpret_cast<const char *>(&tag), sizeof(tag));
+	file.write(reinterpret_cast<const char *>(&count), sizeof(count));
+
+	std::vector<std::uint64_t> words;
+	words.reserve(2 * 4 * 1024);
+	for (std::size_t i = 0; i <= m_mask; i++) {
+		for (const auto & entry : m_buckets[i].entries) {
+			auto data = entry.data.load(std::memory_order_relaxed);
+			words.push_back(entry.check.load(std::memory_order_relaxed) ^ data);
+			words.push_back(data);
+		}
+
+		if (words.size() == words.capacity() || i == m_mask) {
+			file.write(reinterpret_cast<const char *>(words.data()), static_cast<std::streamsize>(words.size() * sizeof(std::uint64_t)));
+			words.clear();
+		}
+	}
+
+	return static_cast<bool>(file);
+}
+
+bool TranspositionTable::load(const std::string & path, std::uint64_t tag) {
+	std::ifstream file(path, std::ios::binary);
+	std::array<char, 8> magic;
+	std::uint64_t version;
+	std::uint64_t saved_tag;
+	std::uint64_t count;
+	file.read(magic.data(), static_cast<std::streamsize>(magic.size()));
+	file.read(reinterpret_cast<char *>(&version), sizeof(version));
+	file.read(reinterpret_cast<char *>(&saved_tag), sizeof(saved_tag));
+	file.read(reinterpret_cast<char *>(&count), sizeof(count));
+	if (!file || magic != table_magic || version != table_version || saved_tag != tag) {
+		return false;
+	}
+
+	// entries are reinserted one by one, so the saved table can be any size
+	std::vector<std::uint64_t> words(2 * 4 * 1024);
+	while (count) {
+		auto chunk = std::min<std::uint64_t>(count, words.size() / 2);
+		file.read(reinterpret_cast<char *>(words.data()), static_cast<std::streamsize>(2 * chunk * sizeof(std::uint64_t)));
+		if (!file) {
+			return false;
+		}
+
+		for (std::size_t i = 0; i < chunk; i++) {
+			auto key = words[2 * i];
+			auto data = words[2 * i + 1];
+			if (key) {
+				insert(key, pack(value_of(data), depth_of(data), m_generation.load(std::memory_order_relaxed)));
+			}
+		}
+		count -= chunk;
+	}
+
+	return true;
+}
+
+std::size_t TranspositionTable::get_capacity() const {
+	return (m_mask + 1) * 4;
+}
@@ -0,0 +1,58 @@
+// SPDX-FileCopyrightText: 2022 metaquarx <metaquarx@protonmail.com>
+// SPDX-License-Identifier: GPL-3.0-only
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+
+// Search results shared between every thread that searches, without locks.
+//
+// The table is a fixed number of cache line sized buckets holding four
+// entries each, picked so it fits the memory budget given at startup. An
+// entry is two words, the packed result and the key xored with it: a read
+// that races with a write sees a mismatched pair and is treated as a miss.
+//
+// A deeper result for a board is never replaced by a shallower one, and
+// results from earlier searches are the first to be evicted for other boards.
+class TranspositionTable {
+public:
+	explicit TranspositionTable(std::size_t budget_bytes);
+
+	std::optional<float> probe(std::uint64_t key, unsigned depth) const;
+	void store(std::uint64_t key, unsigned depth, float value);
+
+	// Ages every entry stored so far. Call it once per game, batch or tick
+	// rather than per move, so results from recent moves are not replaced first
+	void new_search();
+	void clear();
+
+	// The tag is kept with the entries and has to match when loading, so
+	// tables filled by different kinds of search never mix (see table_tag in
+	// Heuristic.hpp)
+	bool save(const std::string & path, std::uint64_t tag = 0) const;
+	bool load(const std::string & path, std::uint64_t tag = 0);
+
+	std::size_t get_capacity() const;
+
+private:
+	struct Entry {
+		std::atomic<std::uint64_t> check;
+		std::atomic<std::uint64_t> data;
+	};
+
+	struct alignas(64) Bucket {
+		std::array<Entry, 4> entries;
+	};
+
+	std::unique_ptr<Bucket[]> m_buckets;
+	std::size_t m_mask;
+	std::atomic<std::uint8_t> m_generation;
+
+	void insert(std::uint64_t key, std::uint64_t data);
+};
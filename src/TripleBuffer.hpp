@@ -0,0 +1,51 @@
+// SPDX-FileCopyrightText: 2022 metaquarx <metaquarx@protonmail.com>
+// SPDX-License-Identifier: GPL-3.0-only
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+// Hands values from one writer thread to one reader thread without locks.
+//
+// The writer fills the back slot and publishes it, the reader picks up the
+// newest published slot whenever it is ready for one. Neither ever waits for
+// the other: the third slot is always free to swap with, and values the
+// reader was too slow to see are simply skipped.
+template <typename T>
+class TripleBuffer {
+public:
+	// Only the writer may touch this
+	T & back() {
+		return m_slots[m_back];
+	}
+
+	void publish() {
+		m_back = m_middle.exchange(static_cast<std::uint8_t>(m_back | fresh_bit), std::memory_order_acq_rel) & index_mask;
+	}
+
+	// Moves the newest published value to the front, false if there was none
+	bool update() {
+		if (!(m_middle.load(std::memory_order_relaxed) & fresh_bit)) {
+			return false;
+		}
+		m_front = m_middle.exchange(m_front, std::memory_order_acq_rel) & index_mask;
+		return true;
+	}
+
+	// Only the reader may touch this
+	const T & front() const {
+		return m_slots[m_front];
+	}
+
+private:
+	static constexpr std::uint8_t index_mask = 3;
+	// set in m_middle while it holds a slot the reader hasn't picked up yet
+	static constexpr std::uint8_t fresh_bit = 4;
+
+	std::array<T, 3> m_slots{};
+	std::uint8_t m_back = 0;
+	std::atomic<std::uint8_t> m_middle{1};
+	std::uint8_t m_front = 2;
+};
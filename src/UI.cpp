@@ -146,6 +146,11 @@ void UI::set_font(const sf::Font &regular, const sf::Font &bold) {
 	center_text(m_game_over_continue);
 	center_text(m_win_continue);
 
+	// the scores are the only text that changes
+	for (char digit = '0'; digit <= '9'; digit++) {
+		bold.getGlyph(static_cast<sf::Uint32>(digit), m_current_score_number.getCharacterSize(), false);
+	}
+
 	m_win_tile.emplace(bold);
 	for (std::size_t i = 0; i < 11; i++) {
 		m_win_tile->increase_value();
@@ -153,6 +158,14 @@ void UI::set_font(const sf::Font &regular, const sf::Font &bold) {
 	m_win_tile->slide({300, 520}, 0);
 	m_win_tile->update(900);
 	m_win_tile->update(900);
+
+	// Laid out now, after the last glyph is loaded (the win tile lays itself
+	// out), so copies of this UI are drawn as they are, without the font
+	for (auto text : {&m_title, &m_prompt, &m_prompt_bold, &m_tutorial_button_text, &m_current_score_tag,
+		&m_current_score_number, &m_best_score_tag, &m_best_score_number, &m_new_game_button_text, &m_tutorial_text,
+		&m_tutorial_text_bold, &m_copyright_text, &m_game_over_text, &m_game_over_continue, &m_win_text, &m_win_continue}) {
+		text->getLocalBounds();
+	}
 }
 
 void UI::draw(sf::RenderTarget &target, sf::RenderStates states) const {
@@ -0,0 +1,82 @@
+// SPDX-FileCopyrightText: 2022 metaquarx <metaquarx@protonmail.com>
+// SPDX-License-Identifier: GPL-3.0-only
+
+#include "WorkerPool.hpp"
+
+WorkerPool::WorkerPool(unsigned threads)
+: m_stopping(false)
+, m_round(0)
+, m_busy(0)
+, m_function(nullptr)
+, m_count(0)
+, m_next(0) {
+	for (unsigned i = 1; i < threads; i++) {
+		m_threads.emplace_back([this] { work(); });
+	}
+}
+
+WorkerPool::~WorkerPool() {
+	{
+		std::lock_guard lock(m_mutex);
+		m_stopping = true;
+	}
+	m_wake.notify_all();
+	for (auto & thread : m_threads) {
+		thread.join();
+	}
+}
+
+void WorkerPool::run(std::size_t count, const std::function<void(std::size_t)> & function) {
+	if (m_threads.empty() || count == 1) {
+		for (std::size_t i = 0; i < count; i++) {
+			function(i);
+		}
+		return;
+	}
+
+	{
+		std::lock_guard lock(m_mutex);
+		m_function = &function;
+		m_count = count;
+		m_next = 0;
+		m_busy = m_threads.size();
+		m_round++;
+	}
+	m_wake.notify_all();
+
+	drain();
+
+	std::unique_lock lock(m_mutex);
+	m_done.wait(lock, [&] { return m_busy == 0; });
+	m_function = nullptr;
+}
+
+unsigned WorkerPool::get_threads() const {
+	return static_cast<unsigned>(m_threads.size() + 1);
+}
+
+void WorkerPool::drain() {
+	for (auto i = m_next++; i < m_count; i = m_next++) {
+		(*m_function)(i);
+	}
+}
+
+void WorkerPool::work() {
+	std::uint64_t seen = 0;
+	std::unique_lock lock(m_mutex);
+	while (true) {
+		m_wake.wait(lock, [&] { return m_stopping || m_round != seen; });
+		if (m_stopping) {
+			return;
+		}
+		seen = m_round;
+
+		lock.unlock();
+		drain();
+		lock.lock();
+
+		if (--m_busy == 0) {
+			m_done.notify_one();
+		}
+	}
+}
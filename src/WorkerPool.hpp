@@ -0,0 +1,46 @@
+// SPDX-FileCopyrightText: 2022 metaquarx <metaquarx@protonmail.com>
+// SPDX-License-Identifier: GPL-3.0-only
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Threads kept around between calls, for work that comes in many small
+// rounds where starting threads each time would cost more than the work
+class WorkerPool {
+public:
+	// The calling thread counts as one of the threads
+	explicit WorkerPool(unsigned threads);
+	~WorkerPool();
+
+	WorkerPool(const WorkerPool &) = delete;
+	WorkerPool & operator=(const WorkerPool &) = delete;
+
+	// Calls function(i) for every i below count, on the pool and the calling
+	// thread, and returns once all of them are done
+	void run(std::size_t count, const std::function<void(std::size_t)> & function);
+
+	unsigned get_threads() const;
+
+private:
+	std::vector<std::thread> m_threads;
+	std::mutex m_mutex;
+	std::condition_variable m_wake;
+	std::condition_variable m_done;
+	bool m_stopping;
+	std::uint64_t m_round;
+	std::size_t m_busy;
+	const std::function<void(std::size_t)> * m_function;
+	std::size_t m_count;
+	std::atomic<std::size_t> m_next;
+
+	void drain();
+	void work();
+};
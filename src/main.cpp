@@ -3,8 +3,59 @@
 
 #include "TFE.hpp"
 
-int main() {
-	TFE game;
+#include <iostream>
+#include <string>
+
+int main(int argc, char ** argv) {
+	TFE::Settings settings;
+	// any of the benchmark options turns benchmarking on
+	auto benchmark = [&]() -> TFE::Benchmark & {
+		if (!settings.benchmark) {
+			settings.benchmark.emplace();
+		}
+		return *settings.benchmark;
+	};
+
+	for (int i = 1; i < argc; i++) {
+		std::string argument = argv[i];
+		if (argument == "--size" && i + 1 < argc) {
+			settings.board_size = std::stoul(argv[++i]);
+		} else if (argument == "--arena" && i + 1 < argc) {
+			settings.arena_boards = std::stoul(argv[++i]);
+		} else if (argument == "--cache" && i + 1 < argc) {
+			settings.cache_file = argv[++i];
+		} else if (argument == "--cache-size" && i + 1 < argc) {
+			settings.cache_megabytes = std::stoul(argv[++i]);
+		} else if (argument == "--benchmark" && i + 1 < argc) {
+			benchmark().moves = std::stoul(argv[++i]);
+		} else if (argument == "--benchmark-script" && i + 1 < argc) {
+			benchmark().script = argv[++i];
+		} else if (argument == "--benchmark-rate" && i + 1 < argc) {
+			benchmark().rate = static_cast<unsigned>(std::stoul(argv[++i]));
+		} else if (argument == "--benchmark-seed" && i + 1 < argc) {
+			benchmark().seed = std::stoull(argv[++i]);
+		} else if (argument == "--frame-times" && i + 1 < argc) {
+			benchmark().frame_times = argv[++i];
+		} else {
+			std::cerr <<
+				"usage: TFE [--size <3-8>] [--arena <boards>] [--cache <file>] [--cache-size <megabytes>]\n"
+				"       TFE [--size <3-8>] --benchmark <moves> [--benchmark-script <file>] [--benchmark-rate <moves per second>]\n"
+				"           [--benchmark-seed <seed>] [--frame-times <file>]\n";
+			return 1;
+		}
+	}
+
+	if (settings.benchmark && settings.arena_boards) {
+		std::cerr << "The arena can't be benchmarked, its games are random\n";
+		return 1;
+	}
+
+	TFE game(settings);
+
+	if (settings.benchmark) {
+		game.benchmark();
+		return 0;
+	}
 
 	while (game.run()) {}
 }